@@ -0,0 +1,638 @@
+#!/usr/bin/env python3
+"""Headless end-to-end benchmark of sinpin_vr.
+
+Starts Xvfb with a RandR monitor layout, runs a synthetic workload (bench/workload.cpp) on it and
+sinpin_vr_mock (the app linked against mock/openvr_mock.cpp, built with SINPIN_PROFILE) next to it.
+For every combination of layout, workload, capture backend and frame interval it reports the CPU
+use of the app and the X server (percent of one core), how busy every core was, frames run, captures uploaded and submitted, bytes uploaded and
+the capture latency (capture request until the texture is handed to the runtime). The app always
+runs with --input xtest, uinput devices would send the scripted input to the desktop session
+instead of Xvfb.
+
+With --save-baseline the results of every case, repeated --repeat times, are stored keyed by
+layout, workload, capture backend, frame interval and added latency. --compare runs the same cases
+and checks each metric against a stored baseline with Welch's t-test, and exits with status 1 when
+one got significantly worse by more than --threshold percent. Cases with a single sample on either
+side can not be tested, their changes are printed as warnings only.
+
+With --alloc-check it runs the first layout and workload with scripted controller input on an app
+built by `make alloccheck`, and fails if any frame allocated memory after one loop of the script.
+
+With --scaling it runs the first workload, capture and frame interval on 1 to 16 monitors in a grid
+(root windows up to 15360 pixels wide) and breaks the frame down into per panel stages, to show
+where the cost stops growing linearly with the number of panels.
+
+With --soak it instead runs one configuration for hours with scripted controller input
+(bench/soak.script), samples memory, file descriptors and CPU per frame every minute and fails when
+they grow beyond the given limits.
+
+Run it through `make bench`, which builds everything it needs, or directly once built.
+Needs Xvfb and xrandr.
+"""
+import argparse
+import json
+import math
+import os
+import platform
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+APP = os.path.join(ROOT, "sinpin_vr_mock")
+WORKLOAD = os.path.join(ROOT, "bench", "workload")
+SOAK_SCRIPT = os.path.join(ROOT, "bench", "soak.script")
+# frames in one loop of the soak script, by then every code path it reaches has run once
+SOAK_LOOP_FRAMES = 2400
+UPDATE_RATE = 120
+MOCK_STATS_INTERVAL = 0.2  # seconds between rewrites of the mock's stats file, the error at both ends of a window
+WORKLOADS = ["idle", "cursor", "terminal", "noise", "drag"]
+CLOCK_TICKS = os.sysconf("SC_CLK_TCK")
+BASELINE_VERSION = 1
+# metrics a baseline compares, and whether a larger value is the better one
+BASELINE_METRICS = [
+	("cpu_app", "app %", False),
+	("cpu_xvfb", "X %", False),
+	("frame_p99_us", "frame p99 us", False),
+	("capture_latency_p99_us", "latency p99 us", False),
+	("upload_mb_per_second", "MB/s uploaded", False),
+	("openvr_calls_per_frame", "vr calls/frame", False),
+	("frames_per_second", "frames/s", True),
+]
+
+
+def parse_layout(text):
+	"""'1920x1080' or '2560x1440,1920x1080' or '3@1920x1080', monitors are placed left to right"""
+	monitors = []
+	x = 0
+	for part in text.split(","):
+		count = 1
+		if "@" in part:
+			count, part = part.split("@")
+			count = int(count)
+		width, height = (int(v) for v in part.split("x"))
+		for _ in range(count):
+			monitors.append((x, 0, width, height))
+			x += width
+	return monitors
+
+
+def grid_layout(count, columns, width, height):
+	"""count monitors of the same size in rows of up to columns"""
+	return [((i % columns) * width, (i // columns) * height, width, height) for i in range(count)]
+
+
+def cpu_seconds(pid):
+	"""user + system time of a process"""
+	with open(f"/proc/{pid}/stat") as f:
+		# the command name can contain spaces, the fields after it can not
+		fields = f.read().rsplit(")", 1)[1].split()
+	return (int(fields[11]) + int(fields[12])) / CLOCK_TICKS
+
+
+def core_busy_seconds():
+	"""time every core spent on anything but idle and iowait since boot, from /proc/stat"""
+	busy = []
+	with open("/proc/stat") as f:
+		for line in f:
+			fields = line.split()
+			# the first line sums every core, the per core ones are cpu0, cpu1, ...
+			if not fields[0].startswith("cpu") or fields[0] == "cpu":
+				continue
+			times = [int(v) for v in fields[1:]]
+			busy.append((sum(times[:8]) - times[3] - times[4]) / CLOCK_TICKS)
+	return busy
+
+
+def memory_stats(pid):
+	"""resident memory, heap and open files of a process, memory in kB"""
+	stats = {"rss_kb": 0, "heap_kb": 0, "anon_kb": 0}
+	with open(f"/proc/{pid}/status") as f:
+		for line in f:
+			if line.startswith("VmRSS:"):
+				stats["rss_kb"] = int(line.split()[1])
+	# the [heap] mapping only covers brk allocations, large ones are anonymous mmaps, so count both
+	# anon_kb leaves out [heap], which is also anonymous, so the two can be added up
+	mapping = None
+	with open(f"/proc/{pid}/smaps") as f:
+		for line in f:
+			fields = line.split()
+			if not fields[0].endswith(":"):
+				mapping = fields[5] if len(fields) > 5 else ""
+			elif fields[0] == "Rss:" and mapping == "[heap]":
+				stats["heap_kb"] += int(fields[1])
+			elif fields[0] == "Anonymous:" and mapping != "[heap]":
+				stats["anon_kb"] += int(fields[1])
+	stats["fds"] = len(os.listdir(f"/proc/{pid}/fd"))
+	return stats
+
+
+class Xvfb:
+	def __init__(self, display, monitors):
+		self.display = display
+		self.env = dict(os.environ, DISPLAY=display)
+		width = max(x + w for x, _, w, _ in monitors)
+		height = max(y + h for _, y, _, h in monitors)
+		self.process = subprocess.Popen(
+			["Xvfb", display, "-screen", "0", f"{width}x{height}x24", "-nolisten", "tcp"],
+			stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+		socket = f"/tmp/.X11-unix/X{display[1:]}"
+		for _ in range(100):
+			if os.path.exists(socket):
+				break
+			if self.process.poll() is not None:
+				sys.exit(f"Xvfb {display} exited, is the display already in use?")
+			time.sleep(0.05)
+		else:
+			self.stop()
+			sys.exit("Xvfb did not start")
+		self.set_monitors(monitors)
+
+	def set_monitors(self, monitors):
+		for i, (x, y, width, height) in enumerate(monitors):
+			# the first monitor takes over the one Xvfb creates for its only output
+			output = "screen" if i == 0 else "none"
+			# physical size does not matter, assume 96 dpi
+			geometry = f"{width}/{width * 254 // 960}x{height}/{height * 254 // 960}+{x}+{y}"
+			subprocess.run(["xrandr", "--setmonitor", f"bench{i}", geometry, output], env=self.env, check=True)
+		listed = subprocess.run(["xrandr", "--listmonitors"], env=self.env, check=True, capture_output=True, text=True)
+		count = int(listed.stdout.split("\n")[0].split(":")[1])
+		if count != len(monitors):
+			self.stop()
+			sys.exit(f"expected {len(monitors)} monitors, xrandr reports:\n{listed.stdout}")
+
+	def stop(self):
+		self.process.terminate()
+		self.process.wait()
+
+
+def read_json(path):
+	try:
+		with open(path) as f:
+			return json.load(f)
+	except (OSError, ValueError):
+		return None
+
+
+def mock_window(start, end):
+	"""OpenVR calls between two snapshots of the mock's stats file, which counts since the app started."""
+	frames = max(end["frames"] - start["frames"], 1)
+	seconds = end["seconds"] - start["seconds"]
+	calls = end["calls"] - start["calls"]
+	submits = (end["methods"].get("SetOverlayTexture", {}).get("calls", 0)
+			   - start["methods"].get("SetOverlayTexture", {}).get("calls", 0))
+	return {"calls_per_frame": calls / frames, "submits_per_second": submits / seconds if seconds > 0 else 0}
+
+
+def run_case(xvfb, workload, capture, frame_interval, args):
+	tmp = tempfile.mkdtemp(prefix="sinpin-bench-")
+	stats_path = os.path.join(tmp, "stats.json")
+	mock_stats_path = os.path.join(tmp, "mock.json")
+	# rewritten often, so the measured window can be cut out of the mock's totals
+	env = dict(xvfb.env, SINPIN_MOCK_STATS=mock_stats_path, SINPIN_MOCK_STATS_INTERVAL=str(MOCK_STATS_INTERVAL))
+	if args.latency_us:
+		env["SINPIN_MOCK_LATENCY_US"] = str(args.latency_us)
+	load = subprocess.Popen([WORKLOAD, workload], env=env)
+	app = subprocess.Popen(
+		[APP, "--input", "xtest", "--capture", capture, "--frame-interval", str(frame_interval), "--stats", stats_path],
+		env=env, stdout=subprocess.DEVNULL if not args.verbose else None)
+	try:
+		time.sleep(args.warmup)
+		if app.poll() is not None:
+			sys.exit(f"{APP} exited during warmup with code {app.returncode}, run with --verbose to see why")
+		# start the app's histograms over so they only cover the measured part
+		app.send_signal(signal.SIGUSR2)
+		mock_start = read_json(mock_stats_path)
+		start = time.monotonic()
+		pids = {"app": app.pid, "xvfb": xvfb.process.pid, "workload": load.pid}
+		cpu_start = {name: cpu_seconds(pid) for name, pid in pids.items()}
+		cores_start = core_busy_seconds()
+		time.sleep(args.duration)
+		cpu_end = {name: cpu_seconds(pid) for name, pid in pids.items()}
+		cores_end = core_busy_seconds()
+		elapsed = time.monotonic() - start
+		mock_end = read_json(mock_stats_path)
+		app.send_signal(signal.SIGINT)
+		app.wait(timeout=10)
+	finally:
+		if app.poll() is None:
+			app.kill()
+		load.kill()
+		load.wait()
+
+	stats = read_json(stats_path)
+	if stats is None or mock_start is None or mock_end is None:
+		sys.exit(f"no stats written by {APP}, is it a profile build (make bench)?")
+	stages = stats["stages"]
+	mock = mock_window(mock_start, mock_end)
+	frames = stages["frame"]["count"]
+	return {
+		"workload": workload,
+		"capture": capture,
+		"frame_interval": frame_interval,
+		"seconds": round(elapsed, 3),
+		# percent of one core
+		"cpu_app": round(100 * (cpu_end["app"] - cpu_start["app"]) / elapsed, 1),
+		"cpu_xvfb": round(100 * (cpu_end["xvfb"] - cpu_start["xvfb"]) / elapsed, 1),
+		"cpu_workload": round(100 * (cpu_end["workload"] - cpu_start["workload"]) / elapsed, 1),
+		# percent of every core on its own, whoever used it
+		"cpu_cores": [round(100 * (end - start) / elapsed, 1) for start, end in zip(cores_start, cores_end)],
+		"frames_per_second": round(frames / elapsed, 1),
+		"captures_per_second": round(stages["panel render"]["count"] / elapsed, 1),
+		"submits_per_second": round(mock["submits_per_second"], 1),
+		"capture_mb_per_second": round(stats["captured_bytes"] / elapsed / 1e6, 1),
+		"upload_mb_per_second": round(stats["uploaded_bytes"] / elapsed / 1e6, 1),
+		"tiles_changed_percent": stats["tiles_changed_percent"],
+		"capture_latency_p50_us": stages["capture latency"]["p50_us"],
+		"capture_latency_p99_us": stages["capture latency"]["p99_us"],
+		"frame_p99_us": stages["frame"]["p99_us"],
+		"openvr_calls_per_frame": round(mock["calls_per_frame"], 3),
+		"stages": stages,
+	}
+
+
+def soak(args):
+	monitors = parse_layout(args.layouts[0])
+	workload = args.workloads[0] if len(args.workloads) == 1 else "terminal"
+	capture = args.captures[0]
+	frame_interval = args.frame_intervals[0]
+	tmp = tempfile.mkdtemp(prefix="sinpin-soak-")
+	mock_stats_path = os.path.join(tmp, "mock.json")
+	print(f"soaking {args.soak} hours: layout {args.layouts[0]}, workload {workload}, capture {capture}, frame interval {frame_interval}")
+
+	xvfb = Xvfb(args.display, monitors)
+	env = dict(xvfb.env, SINPIN_MOCK_STATS=mock_stats_path, SINPIN_MOCK_SCRIPT=SOAK_SCRIPT,
+			   SINPIN_MOCK_STATS_INTERVAL=str(args.sample_interval / 2))
+	load = subprocess.Popen([WORKLOAD, workload], env=env)
+	app = subprocess.Popen([APP, "--input", "xtest", "--capture", capture, "--frame-interval", str(frame_interval)],
+						   env=env, stdout=subprocess.DEVNULL if not args.verbose else None)
+	samples = []
+	failures = []
+	end = time.monotonic() + args.soak * 3600
+	print(f"{'minutes':>8} {'rss MB':>8} {'heap MB':>8} {'anon MB':>8} {'fds':>5} {'cpu us/frame':>13} {'frames':>10}")
+	try:
+		last_cpu, last_frames = cpu_seconds(app.pid), 0
+		start = time.monotonic()
+		while time.monotonic() < end:
+			time.sleep(args.sample_interval)
+			if app.poll() is not None:
+				failures.append(f"app exited with code {app.returncode}")
+				break
+			mock = read_json(mock_stats_path) or {"frames": last_frames}
+			cpu = cpu_seconds(app.pid)
+			frames = mock["frames"] - last_frames
+			sample = memory_stats(app.pid)
+			sample["minutes"] = round((time.monotonic() - start) / 60, 2)
+			sample["frames"] = mock["frames"]
+			sample["cpu_us_per_frame"] = round((cpu - last_cpu) * 1e6 / frames, 1) if frames else 0
+			last_cpu, last_frames = cpu, mock["frames"]
+			samples.append(sample)
+			print(f"{sample['minutes']:8.1f} {sample['rss_kb'] / 1024:8.1f} {sample['heap_kb'] / 1024:8.1f} {sample['anon_kb'] / 1024:8.1f} "
+				  f"{sample['fds']:5} {sample['cpu_us_per_frame']:13.1f} {sample['frames']:10}", flush=True)
+	finally:
+		if app.poll() is None:
+			app.send_signal(signal.SIGINT)
+			try:
+				app.wait(timeout=10)
+			except subprocess.TimeoutExpired:
+				app.kill()
+		load.kill()
+		xvfb.stop()
+
+	# compare against the state after warmup, and the median of the last few samples against it to ignore spikes
+	warm = [s for s in samples if s["minutes"] >= args.warmup / 60]
+	if len(warm) >= 2:
+		base = warm[0]
+		last = warm[-3:]
+
+		def final(key):
+			return sorted(s[key] for s in last)[len(last) // 2]
+
+		rss_growth = (final("rss_kb") - base["rss_kb"]) / 1024
+		heap_growth = (final("heap_kb") + final("anon_kb") - base["heap_kb"] - base["anon_kb"]) / 1024
+		fd_growth = final("fds") - base["fds"]
+		cpu_drift = 100 * (final("cpu_us_per_frame") / base["cpu_us_per_frame"] - 1) if base["cpu_us_per_frame"] else 0
+		print(f"\nafter warmup: rss {rss_growth:+.1f} MB, heap {heap_growth:+.1f} MB, fds {fd_growth:+d}, cpu per frame {cpu_drift:+.1f}%")
+		if rss_growth > args.max_rss_growth:
+			failures.append(f"rss grew by {rss_growth:.1f} MB, limit {args.max_rss_growth}")
+		if heap_growth > args.max_heap_growth:
+			failures.append(f"heap grew by {heap_growth:.1f} MB, limit {args.max_heap_growth}")
+		if fd_growth > args.max_fd_growth:
+			failures.append(f"{fd_growth} more open files, limit {args.max_fd_growth}")
+		if cpu_drift > args.max_cpu_drift:
+			failures.append(f"cpu per frame rose by {cpu_drift:.1f}%, limit {args.max_cpu_drift}%")
+	else:
+		failures.append("not enough samples after warmup, run longer than --warmup")
+
+	if args.output:
+		with open(args.output, "w") as f:
+			json.dump({"soak": samples, "failures": failures}, f, indent=1)
+	for failure in failures:
+		print(f"FAIL: {failure}")
+	return 1 if failures else 0
+
+
+def alloc_check(args):
+	"""runs every capture backend with scripted input, returns the number that allocated after warmup"""
+	monitors = parse_layout(args.layouts[0])
+	workload = args.workloads[0] if len(args.workloads) == 1 else "terminal"
+	warmup_frames = SOAK_LOOP_FRAMES
+	failures = 0
+	xvfb = Xvfb(args.display, monitors)
+	try:
+		for capture in args.captures:
+			print(f"allocations: layout {args.layouts[0]}, workload {workload}, capture {capture}, {warmup_frames} warmup frames")
+			env = dict(xvfb.env, SINPIN_MOCK_SCRIPT=SOAK_SCRIPT)
+			load = subprocess.Popen([WORKLOAD, workload], env=env)
+			app = subprocess.Popen([APP, "--input", "xtest", "--capture", capture, "--alloc-warmup", str(warmup_frames)],
+								   env=env, stdout=subprocess.PIPE, text=True)
+			try:
+				time.sleep(warmup_frames / UPDATE_RATE + args.duration)
+				app.send_signal(signal.SIGINT)
+				output, _ = app.communicate(timeout=10)
+			finally:
+				if app.poll() is None:
+					app.kill()
+				load.kill()
+				load.wait()
+			lines = output.splitlines()
+			print("\n".join(lines if args.verbose else [l for l in lines if l.startswith(("frame ", "allocations"))]))
+			if app.returncode != 0:
+				failures += 1
+	finally:
+		xvfb.stop()
+	return failures
+
+
+# profiler stages that make up the per panel work, see src/profiler.h
+SCALING_STAGES = ["framebuffer", "capture wait", "tile hash", "upload", "submit", "panel cursor", "picking"]
+
+
+def stage_per_frame(result, stage):
+	"""microseconds a stage takes per frame, summed over every panel"""
+	stages = result["stages"]
+	frames = stages["frame"]["count"]
+	return stages[stage]["mean_us"] * stages[stage]["count"] / frames if frames else 0
+
+
+def scaling(args):
+	width, height = (int(v) for v in args.monitor_size.split("x"))
+	workload = args.workloads[0] if len(args.workloads) == 1 else "idle"
+	capture = args.captures[0]
+	frame_interval = args.frame_intervals[0]
+	print(f"scaling: {args.monitor_size} monitors, up to {args.columns} per row, workload {workload}, capture {capture}, frame interval {frame_interval}")
+	print("microseconds per frame, x linear is the per panel cost relative to one panel")
+	names = ["monitors", "root", "app %", "X %"] + SCALING_STAGES + ["frame p99", "x linear"]
+	print("  ".join(f"{n:>12}" for n in names))
+
+	# x linear needs the cost of a single panel, so that case always runs, and runs first
+	counts = [1] + [count for count in args.scaling if count != 1]
+	results = []
+	single_panel_cost = None
+	for count in counts:
+		monitors = grid_layout(count, min(count, args.columns), width, height)
+		xvfb = Xvfb(args.display, monitors)
+		try:
+			result = run_case(xvfb, workload, capture, frame_interval, args)
+		finally:
+			xvfb.stop()
+		root = f"{max(x + w for x, _, w, _ in monitors)}x{max(y + h for _, y, _, h in monitors)}"
+		result["monitors"] = count
+		result["root"] = root
+		result["per_frame_us"] = {stage: round(stage_per_frame(result, stage), 2) for stage in SCALING_STAGES}
+		panel_cost = sum(result["per_frame_us"].values()) / count
+		if count == 1:
+			single_panel_cost = panel_cost
+		result["linearity"] = round(panel_cost / single_panel_cost, 2) if single_panel_cost else 0
+		results.append(result)
+		values = [str(count), root, f"{result['cpu_app']:.1f}", f"{result['cpu_xvfb']:.1f}"]
+		values += [f"{result['per_frame_us'][stage]:.1f}" for stage in SCALING_STAGES]
+		values += [f"{result['frame_p99_us']:.0f}", f"{result['linearity']:.2f}"]
+		print("  ".join(f"{v:>12}" for v in values), flush=True)
+
+	if args.output:
+		with open(args.output, "w") as f:
+			json.dump({"scaling": results}, f, indent=1)
+		print(f"\nwrote {args.output}")
+
+
+COLUMNS = [
+	("workload", "workload", "{}"),
+	("capture", "capture", "{}"),
+	("frame_interval", "interval", "{}"),
+	("cpu_app", "app %", "{:.1f}"),
+	("cpu_xvfb", "X %", "{:.1f}"),
+	("cpu_cores", "cores %", lambda cores: " ".join(f"{core:.0f}" for core in cores)),
+	("frames_per_second", "frames/s", "{:.1f}"),
+	("captures_per_second", "captures/s", "{:.1f}"),
+	("submits_per_second", "submits/s", "{:.1f}"),
+	("upload_mb_per_second", "MB/s", "{:.1f}"),
+	("tiles_changed_percent", "changed %", "{:.1f}"),
+	("capture_latency_p50_us", "lat p50 us", "{:.0f}"),
+	("capture_latency_p99_us", "lat p99 us", "{:.0f}"),
+	("openvr_calls_per_frame", "vr calls/frame", "{:.1f}"),
+]
+
+
+def case_key(result):
+	return f"{result['layout']} {result['workload']} {result['capture']} interval {result['frame_interval']} latency {result['latency_us']:g}us"
+
+
+def mean(values):
+	return sum(values) / len(values)
+
+
+def variance(values):
+	m = mean(values)
+	return sum((v - m) ** 2 for v in values) / (len(values) - 1)
+
+
+def student_t95(df):
+	"""two sided 95% quantile of Student's t distribution, same table as bench/micro.cpp"""
+	table = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+			 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+			 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+	if df <= 30:
+		return table[max(int(df), 1) - 1]
+	if df <= 60:
+		return 2.000
+	if df <= 120:
+		return 1.980
+	return 1.960
+
+
+def significant(before, after):
+	"""Welch's t-test at 95%, needs at least two samples on each side"""
+	if len(before) < 2 or len(after) < 2:
+		return None
+	v_before = variance(before) / len(before)
+	v_after = variance(after) / len(after)
+	if v_before + v_after == 0:
+		return mean(before) != mean(after)
+	t = abs(mean(after) - mean(before)) / math.sqrt(v_before + v_after)
+	df = (v_before + v_after) ** 2 / (v_before ** 2 / (len(before) - 1) + v_after ** 2 / (len(after) - 1))
+	return t > student_t95(df)
+
+
+def save_baseline(path, cases):
+	commit = subprocess.run(["git", "-C", ROOT, "rev-parse", "--short", "HEAD"], capture_output=True, text=True)
+	baseline = {
+		"version": BASELINE_VERSION,
+		"created": time.strftime("%Y-%m-%dT%H:%M:%S"),
+		"host": platform.node(),
+		"commit": commit.stdout.strip(),
+		"cases": {key: {"config": case["config"], "samples": case["samples"]} for key, case in cases.items()},
+	}
+	with open(path + ".tmp", "w") as f:
+		json.dump(baseline, f, indent=1)
+	os.rename(path + ".tmp", path)
+	print(f"\nsaved baseline {path}")
+
+
+def compare_baseline(path, cases, threshold):
+	"""prints every metric that changed significantly, returns the number of regressions
+	metrics with a single sample before or after are only reported, never counted as regressions"""
+	baseline = read_json(path)
+	if baseline is None:
+		sys.exit(f"could not read baseline {path}")
+	if baseline.get("version") != BASELINE_VERSION:
+		sys.exit(f"{path} is a version {baseline.get('version')} baseline, this script reads version {BASELINE_VERSION}")
+	print(f"\ncompared to {path} (commit {baseline['commit'] or '?'}, {baseline['created']} on {baseline['host']})")
+	print(f"{'case':<48} {'metric':>16} {'before':>10} {'after':>10} {'change':>8}")
+	regressions = 0
+	for key, case in cases.items():
+		if key not in baseline["cases"]:
+			print(f"{key:<48} not in baseline")
+			continue
+		for metric, name, higher_is_better in BASELINE_METRICS:
+			before = baseline["cases"][key]["samples"].get(metric)
+			after = case["samples"][metric]
+			if not before:
+				continue
+			b, a = mean(before), mean(after)
+			change = 100 * (a - b) / b if b else (0 if a == b else math.inf)
+			worse = change < 0 if higher_is_better else change > 0
+			if abs(change) <= threshold:
+				continue
+			is_significant = significant(before, after)
+			if is_significant is False:
+				continue
+			if is_significant is None:
+				# without two samples on each side there is no variance to test against, so it can only warn
+				verdict = "worse" if worse else "better"
+				verdict += " (one sample, not tested, use --repeat 2 or more)"
+			elif worse:
+				verdict = "REGRESSION"
+				regressions += 1
+			else:
+				verdict = "improved"
+			print(f"{key:<48} {name:>16} {b:>10.1f} {a:>10.1f} {change:>+7.1f}% {verdict}")
+	if regressions:
+		print(f"{regressions} regressions beyond {threshold}%")
+	else:
+		print(f"no regressions beyond {threshold}%")
+	return regressions
+
+
+def print_row(values):
+	print("  ".join(f"{v:>{max(len(c[1]), 10)}}" for v, c in zip(values, COLUMNS)))
+
+
+def print_result(result):
+	print_row([fmt(result[key]) if callable(fmt) else fmt.format(result[key]) for key, _, fmt in COLUMNS])
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+	parser.add_argument("--layouts", nargs="+", default=["1920x1080", "2@1920x1080"],
+						help="monitor layouts, eg. 2560x1440,1920x1080 or 3@1920x1080")
+	parser.add_argument("--workloads", nargs="+", default=WORKLOADS, choices=WORKLOADS)
+	parser.add_argument("--captures", nargs="+", default=["shm", "getimage"], choices=["shm", "getimage"])
+	parser.add_argument("--frame-intervals", nargs="+", type=int, default=[4])
+	parser.add_argument("--duration", type=float, default=20, help="measured seconds per case")
+	parser.add_argument("--warmup", type=float, default=3, help="seconds before measuring")
+	parser.add_argument("--latency-us", type=float, default=0, help="added to every OpenVR call")
+	parser.add_argument("--display", default=":99")
+	parser.add_argument("--output", help="write all results to this json file")
+	parser.add_argument("--verbose", action="store_true", help="show the app's output")
+	baseline_args = parser.add_argument_group("baselines")
+	baseline_args.add_argument("--repeat", type=int, default=1,
+							   help="runs per case, the t-test in --compare needs at least 2 on both sides")
+	baseline_args.add_argument("--save-baseline", metavar="FILE", help="store the results of every run")
+	baseline_args.add_argument("--compare", metavar="FILE", help="compare with a stored baseline")
+	baseline_args.add_argument("--threshold", type=float, default=5,
+							   help="percent a metric has to change by to count as a regression")
+	parser.add_argument("--alloc-check", action="store_true",
+						help="check that the frame loop does not allocate, needs make alloccheck")
+	scaling_args = parser.add_argument_group("monitor count scaling, runs the first workload, capture and frame interval given")
+	scaling_args.add_argument("--scaling", nargs="*", type=int, metavar="COUNT",
+							  help="run with each of these monitor counts instead (default 1 2 4 8 16), one monitor always runs first as the baseline")
+	scaling_args.add_argument("--monitor-size", default="1920x1080")
+	scaling_args.add_argument("--columns", type=int, default=8, help="monitors per row")
+	soak_args = parser.add_argument_group("soak test, runs the first layout, capture and frame interval given")
+	soak_args.add_argument("--soak", type=float, metavar="HOURS", help="run one configuration this long instead")
+	soak_args.add_argument("--sample-interval", type=float, default=60, help="seconds between samples")
+	soak_args.add_argument("--max-rss-growth", type=float, default=16, help="MB")
+	soak_args.add_argument("--max-heap-growth", type=float, default=8, help="MB")
+	soak_args.add_argument("--max-fd-growth", type=int, default=0)
+	soak_args.add_argument("--max-cpu-drift", type=float, default=20, help="percent")
+	args = parser.parse_args()
+
+	for path in (APP, WORKLOAD):
+		if not os.access(path, os.X_OK):
+			sys.exit(f"{path} not found, run 'make bench'")
+	if args.soak:
+		# the default warmup is meant for short runs, give allocators and caches a few minutes
+		if args.warmup == parser.get_default("warmup"):
+			args.warmup = 5 * args.sample_interval
+		sys.exit(soak(args))
+	if args.alloc_check:
+		sys.exit(1 if alloc_check(args) else 0)
+	if args.scaling is not None:
+		args.scaling = args.scaling or [1, 2, 4, 8, 16]
+		scaling(args)
+		return
+
+	results = []
+	cases = {}
+	for layout in args.layouts:
+		monitors = parse_layout(layout)
+		print(f"\nlayout {layout}: {len(monitors)} monitors")
+		print_row([name for _, name, _ in COLUMNS])
+		xvfb = Xvfb(args.display, monitors)
+		try:
+			for workload in args.workloads:
+				for capture in args.captures:
+					for frame_interval in args.frame_intervals:
+						for _ in range(max(args.repeat, 1)):
+							result = run_case(xvfb, workload, capture, frame_interval, args)
+							result["layout"] = layout
+							result["latency_us"] = args.latency_us
+							results.append(result)
+							print_result(result)
+							key = case_key(result)
+							if key not in cases:
+								config = ("layout", "workload", "capture", "frame_interval", "latency_us")
+								cases[key] = {
+									"config": {name: result[name] for name in config},
+									"samples": {metric: [] for metric, _, _ in BASELINE_METRICS},
+								}
+							for metric, _, _ in BASELINE_METRICS:
+								cases[key]["samples"][metric].append(result[metric])
+		finally:
+			xvfb.stop()
+
+	if args.output:
+		with open(args.output, "w") as f:
+			json.dump({"results": results}, f, indent=1)
+		print(f"\nwrote {args.output}")
+	if args.save_baseline:
+		save_baseline(args.save_baseline, cases)
+	if args.compare and compare_baseline(args.compare, cases, args.threshold):
+		sys.exit(1)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,295 @@
+// Microbenchmarks of the math that runs several times per frame (src/mapping.cpp and ConvertMat), and of
+// the pixel format conversion that runs on every capture of a 16 or 30 bit desktop (src/pixelformat.cpp).
+// usage: micro [--reps n] [--warmup seconds] [--filter substring] [--output file.json]
+//
+// Every benchmark is calibrated so one sample takes at least MIN_SAMPLE_NS, warmed up, then sampled
+// reps times. Results are per call, with a 95% confidence interval of the mean from Student's t.
+// The kernels are checked against each other by make pixeltest, not here.
+#include "../src/mapping.h"
+#include "../src/pixelformat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <time.h>
+#include <vector>
+
+const uint64_t MIN_SAMPLE_NS = 5000000;
+const int INPUT_COUNT = 256; // inputs are cycled through so branches and caches see some variety
+const int PANEL_COUNTS[] = {1, 4, 16};
+const int MAX_PANELS = 16;
+const int FRAME_WIDTH = 3840;
+const int FRAME_HEIGHT = 2160;
+const double TARGET_RATE = 90; // frames per second the conversion has to keep up with
+
+static uint64_t Now()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+// keeps the compiler from dropping a result it can see is unused
+template <typename T>
+static void Use(const T &value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Benchmark
+{
+	std::string name;
+	std::function<void(uint64_t iterations)> run;
+};
+
+struct Result
+{
+	std::string name;
+	uint64_t iterations;
+	int reps;
+	double mean, median, stddev, ci95, min;
+};
+
+// two sided 95% quantile of Student's t distribution
+static double StudentT95(int df)
+{
+	static const double table[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+	if (df <= 30)
+		return table[std::max(df, 1) - 1];
+	if (df <= 60)
+		return 2.000;
+	if (df <= 120)
+		return 1.980;
+	return 1.960;
+}
+
+static Result Measure(const Benchmark &bench, int reps, double warmup_seconds)
+{
+	uint64_t iterations = 1;
+	while (true)
+	{
+		uint64_t start = Now();
+		bench.run(iterations);
+		if (Now() - start >= MIN_SAMPLE_NS)
+			break;
+		iterations *= 2;
+	}
+	uint64_t warmup_end = Now() + warmup_seconds * 1e9;
+	while (Now() < warmup_end)
+		bench.run(iterations);
+
+	std::vector<double> samples;
+	for (int i = 0; i < reps; i++)
+	{
+		uint64_t start = Now();
+		bench.run(iterations);
+		samples.push_back((Now() - start) / (double)iterations);
+	}
+
+	Result result;
+	result.name = bench.name;
+	result.iterations = iterations;
+	result.reps = reps;
+	double sum = 0;
+	for (double s : samples)
+		sum += s;
+	result.mean = sum / reps;
+	double variance = 0;
+	for (double s : samples)
+		variance += (s - result.mean) * (s - result.mean);
+	result.stddev = reps > 1 ? sqrt(variance / (reps - 1)) : 0;
+	result.ci95 = StudentT95(reps - 1) * result.stddev / sqrt(reps);
+	std::sort(samples.begin(), samples.end());
+	result.median = samples[reps / 2];
+	result.min = samples[0];
+	return result;
+}
+
+static float Random(float min, float max)
+{
+	return min + (max - min) * (rand() / (float)RAND_MAX);
+}
+
+static glm::mat4x4 RandomPose(glm::vec3 center, float spread)
+{
+	float yaw = Random(-0.5f, 0.5f), pitch = Random(-0.5f, 0.5f);
+	glm::mat4x4 pose(1.0f);
+	pose[0] = glm::vec4(cosf(yaw), 0, -sinf(yaw), 0);
+	pose[1] = glm::vec4(sinf(yaw) * sinf(pitch), cosf(pitch), cosf(yaw) * sinf(pitch), 0);
+	pose[2] = glm::vec4(sinf(yaw) * cosf(pitch), -sinf(pitch), cosf(yaw) * cosf(pitch), 0);
+	pose[3] = glm::vec4(center + glm::vec3(Random(-spread, spread), Random(-spread, spread), Random(-spread, spread)), 1);
+	return pose;
+}
+
+static void AddConversionBenchmarks(std::vector<Benchmark> &benchmarks)
+{
+	static std::vector<uint8_t> src(FRAME_WIDTH * FRAME_HEIGHT * 4);
+	static std::vector<uint8_t> dst(FRAME_WIDTH * FRAME_HEIGHT * 4);
+	for (auto &byte : src)
+		byte = rand();
+	for (int kernel = 0; kernel < PixelKernelCount(); kernel++)
+	{
+		for (auto format : {PixelFormat::R5G6B5, PixelFormat::X2R10G10B10})
+		{
+			std::string name = std::string("ConvertToBgrx ") + PixelFormatName(format) + " 4K " + PixelKernelName(kernel);
+			benchmarks.push_back({name, [kernel, format](uint64_t n) {
+									  size_t stride = ZPixmapStride(format, FRAME_WIDTH, 32);
+									  for (uint64_t i = 0; i < n; i++)
+									  {
+										  ConvertToBgrxWith(kernel, format, src.data(), stride, dst.data(), FRAME_WIDTH, FRAME_HEIGHT);
+										  Use(dst[i % dst.size()]);
+									  }
+								  }});
+		}
+	}
+}
+
+static std::vector<Benchmark> CreateBenchmarks()
+{
+	static glm::mat4x4 poses[INPUT_COUNT];
+	static VRMat vr_poses[INPUT_COUNT];
+	static glm::vec3 points[INPUT_COUNT];
+	static glm::vec3 directions[INPUT_COUNT];
+	static glm::mat4x4 panels[MAX_PANELS];
+	srand(1);
+	for (int i = 0; i < INPUT_COUNT; i++)
+	{
+		// controllers in front of the panels, pointing roughly at them
+		poses[i] = RandomPose(glm::vec3(0, 1.2f, 0.6f), 0.3f);
+		vr_poses[i] = ConvertMat(poses[i]);
+		points[i] = glm::vec3(Random(-0.5f, 0.5f), Random(-0.3f, 0.3f), 0);
+		directions[i] = -glm::vec3(poses[i][2]);
+	}
+	for (int i = 0; i < MAX_PANELS; i++)
+	{
+		// a 4x4 wall of 1m wide panels, like the default layout
+		panels[i] = glm::mat4x4(1.0f);
+		panels[i][3] = glm::vec4((i % 4) - 1.5f, 1.2f + (i / 4) * 0.6f - 0.9f, 0, 1);
+	}
+
+	std::vector<Benchmark> benchmarks;
+	benchmarks.push_back({"ConvertMat VRMat to glm", [](uint64_t n) {
+							  for (uint64_t i = 0; i < n; i++)
+								  Use(ConvertMat(vr_poses[i % INPUT_COUNT]));
+						  }});
+	benchmarks.push_back({"ConvertMat glm to VRMat", [](uint64_t n) {
+							  for (uint64_t i = 0; i < n; i++)
+								  Use(ConvertMat(poses[i % INPUT_COUNT]));
+						  }});
+	benchmarks.push_back({"Overlay::IntersectRay", [](uint64_t n) {
+							  for (uint64_t i = 0; i < n; i++)
+							  {
+								  int k = i % INPUT_COUNT;
+								  Use(IntersectRect(panels[0], 1.0f, 0.5625f, GetPos(poses[k]), directions[k], 8.0f));
+							  }
+						  }});
+	for (int count : PANEL_COUNTS)
+	{
+		// App::IntersectRay without the transform queries to the runtime, which the mock would only guess at
+		benchmarks.push_back({"App::IntersectRay " + std::to_string(count) + " panels", [count](uint64_t n) {
+								  for (uint64_t i = 0; i < n; i++)
+								  {
+									  int k = i % INPUT_COUNT;
+									  RectHit nearest{8.0f, glm::vec3(0)};
+									  for (int p = 0; p < count; p++)
+									  {
+										  auto hit = IntersectRect(panels[p], 1.0f, 0.5625f, GetPos(poses[k]), directions[k], 8.0f);
+										  if (hit.distance < nearest.distance)
+											  nearest = hit;
+									  }
+									  Use(nearest);
+								  }
+							  }});
+	}
+	benchmarks.push_back({"LaserToPixel", [](uint64_t n) {
+							  for (uint64_t i = 0; i < n; i++)
+								  Use(LaserToPixel(points[i % INPUT_COUNT], 1.0f, 0.5625f, 1920));
+						  }});
+	benchmarks.push_back({"LaserTransform", [](uint64_t n) {
+							  for (uint64_t i = 0; i < n; i++)
+							  {
+								  int k = i % INPUT_COUNT;
+								  Use(LaserTransform(poses[k], glm::vec3(0, 1.6f, 1.0f), 1.0f + k * 0.01f, 0.004f));
+							  }
+						  }});
+	benchmarks.push_back({"CursorOverridePosition", [](uint64_t n) {
+							  for (uint64_t i = 0; i < n; i++)
+								  Use(CursorOverridePosition(i % 1920, i % 1080, 1920, 1080));
+						  }});
+	benchmarks.push_back({"CursorOverlayTransform", [](uint64_t n) {
+							  for (uint64_t i = 0; i < n; i++)
+								  Use(CursorOverlayTransform(i % 1920, i % 1080, 1920, 1080, 24, 24, 4, 2, 1.0f / 1920));
+						  }});
+	AddConversionBenchmarks(benchmarks);
+	return benchmarks;
+}
+
+static bool WriteJson(const char *path, const std::vector<Result> &results)
+{
+	FILE *file = fopen(path, "w");
+	if (file == nullptr)
+	{
+		printf("Could not write %s\n", path);
+		return false;
+	}
+	fprintf(file, "{\"unit\":\"ns\",\"benchmarks\":[");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		auto &r = results[i];
+		fprintf(file, "%s\n{\"name\":\"%s\",\"iterations\":%lu,\"reps\":%d,\"mean\":%.4f,\"median\":%.4f,\"stddev\":%.4f,\"ci95\":%.4f,\"min\":%.4f}",
+				i ? "," : "", r.name.c_str(), r.iterations, r.reps, r.mean, r.median, r.stddev, r.ci95, r.min);
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	int reps = 30;
+	double warmup = 0.2;
+	const char *filter = nullptr;
+	const char *output = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc)
+			reps = std::max(atoi(argv[++i]), 2);
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+			warmup = atof(argv[++i]);
+		else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			filter = argv[++i];
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else
+		{
+			printf("usage: micro [--reps n] [--warmup seconds] [--filter substring] [--output file.json]\n");
+			return 1;
+		}
+	}
+
+	std::vector<Benchmark> benchmarks;
+	for (auto &bench : CreateBenchmarks())
+	{
+		if (filter == nullptr || bench.name.find(filter) != std::string::npos)
+			benchmarks.push_back(bench);
+	}
+
+	std::vector<Result> results;
+	printf("%-36s %10s %10s %10s %10s\n", "ns per call", "mean", "+-95%", "median", "min");
+	for (auto &bench : benchmarks)
+	{
+		auto result = Measure(bench, reps, warmup);
+		printf("%-36s %10.2f %10.2f %10.2f %10.2f\n", result.name.c_str(), result.mean, result.ci95, result.median, result.min);
+		results.push_back(result);
+	}
+	printf("4K at %.0f Hz leaves %.0f ns per frame for conversion\n", TARGET_RATE, 1e9 / TARGET_RATE);
+	if (output != nullptr && !WriteJson(output, results))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,201 @@
+// Synthetic desktop activity for bench/bench.py, runs on $DISPLAY until killed.
+// usage: workload <idle|cursor|terminal|noise|drag>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include <unistd.h>
+
+const int TERMINAL_WIDTH = 1000;
+const int TERMINAL_HEIGHT = 700;
+const int LINE_HEIGHT = 14;
+const int DRAG_WIDTH = 640;
+const int DRAG_HEIGHT = 480;
+
+static Display *display;
+static int screen_width;
+static int screen_height;
+
+static uint64_t Now()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+// sleeps until the next tick of a fixed interval in nanoseconds, so slow frames do not change the amount of work
+class Ticker
+{
+  public:
+	Ticker(uint64_t interval) : _interval(interval), _next(Now())
+	{
+	}
+	void Wait()
+	{
+		_next += _interval;
+		timespec t{(time_t)(_next / 1000000000), (long)(_next % 1000000000)};
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, nullptr))
+			;
+	}
+
+  private:
+	uint64_t _interval;
+	uint64_t _next;
+};
+
+static Window CreateWindow(int x, int y, int width, int height, unsigned long background)
+{
+	// override redirect keeps the position exact if a window manager happens to be running
+	XSetWindowAttributes attributes;
+	attributes.override_redirect = true;
+	attributes.background_pixel = background;
+	Window window = XCreateWindow(
+		display, DefaultRootWindow(display),
+		x, y, width, height, 0,
+		CopyFromParent, InputOutput, CopyFromParent,
+		CWOverrideRedirect | CWBackPixel, &attributes);
+	XMapRaised(display, window);
+	XSync(display, false);
+	return window;
+}
+
+static XImage *CreateImage(int width, int height)
+{
+	char *data = (char *)malloc(width * height * 4);
+	return XCreateImage(display, DefaultVisual(display, 0), DefaultDepth(display, 0), ZPixmap, 0, data, width, height, 32, 0);
+}
+
+static void Idle()
+{
+	while (true)
+		pause();
+}
+
+// a text cursor blinking at the usual 530ms
+static void BlinkingCursor()
+{
+	Window window = CreateWindow(0, 0, TERMINAL_WIDTH, TERMINAL_HEIGHT, 0x202020);
+	GC gc = XCreateGC(display, window, 0, nullptr);
+	XSetForeground(display, gc, 0xe0e0e0);
+	bool shown = false;
+	Ticker ticker(530 * 1000000ull);
+	while (true)
+	{
+		shown = !shown;
+		if (shown)
+			XFillRectangle(display, window, gc, 40, 40, 8, LINE_HEIGHT);
+		else
+			XClearArea(display, window, 40, 40, 8, LINE_HEIGHT, false);
+		XFlush(display);
+		ticker.Wait();
+	}
+}
+
+// a terminal printing 60 lines per second
+static void Terminal()
+{
+	Window window = CreateWindow(0, 0, TERMINAL_WIDTH, TERMINAL_HEIGHT, 0x202020);
+	GC gc = XCreateGC(display, window, 0, nullptr);
+	XSetForeground(display, gc, 0xe0e0e0);
+	XSetGraphicsExposures(display, gc, false);
+	Ticker ticker(1000000000ull / 60);
+	char line[128];
+	for (uint64_t i = 0;; i++)
+	{
+		XCopyArea(display, window, window, gc, 0, LINE_HEIGHT, TERMINAL_WIDTH, TERMINAL_HEIGHT - LINE_HEIGHT, 0, 0);
+		XClearArea(display, window, 0, TERMINAL_HEIGHT - LINE_HEIGHT, TERMINAL_WIDTH, LINE_HEIGHT, false);
+		int len = snprintf(line, sizeof(line), "%08lu  building src/panel.cpp ... %lx %lx %lx", i, i * 2654435761u, i * 40503u, ~i);
+		XDrawString(display, window, gc, 4, TERMINAL_HEIGHT - 3, line, len);
+		XFlush(display);
+		ticker.Wait();
+	}
+}
+
+// every pixel of every screen changes at 30 fps, like full screen video
+static void Noise()
+{
+	Window window = CreateWindow(0, 0, screen_width, screen_height, 0);
+	GC gc = XCreateGC(display, window, 0, nullptr);
+	XImage *image = CreateImage(screen_width, screen_height);
+	uint32_t *pixels = (uint32_t *)image->data;
+	uint32_t state = 0x12345678;
+	Ticker ticker(1000000000ull / 30);
+	while (true)
+	{
+		for (int i = 0; i < screen_width * screen_height; i++)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			pixels[i] = state;
+		}
+		XPutImage(display, window, gc, image, 0, 0, 0, 0, screen_width, screen_height);
+		XFlush(display);
+		ticker.Wait();
+	}
+}
+
+// a window being dragged around across all screens at 60 fps
+static void Drag()
+{
+	Window window = CreateWindow(0, 0, DRAG_WIDTH, DRAG_HEIGHT, 0);
+	GC gc = XCreateGC(display, window, 0, nullptr);
+	XImage *image = CreateImage(DRAG_WIDTH, DRAG_HEIGHT);
+	uint32_t *pixels = (uint32_t *)image->data;
+	for (int y = 0; y < DRAG_HEIGHT; y++)
+	{
+		for (int x = 0; x < DRAG_WIDTH; x++)
+			pixels[y * DRAG_WIDTH + x] = (x * 255 / DRAG_WIDTH) << 16 | (y * 255 / DRAG_HEIGHT) << 8 | 0x80;
+	}
+	XPutImage(display, window, gc, image, 0, 0, 0, 0, DRAG_WIDTH, DRAG_HEIGHT);
+	int range_x = screen_width - DRAG_WIDTH;
+	int range_y = screen_height - DRAG_HEIGHT;
+	int x = 0, y = 0, dx = 7, dy = 5;
+	Ticker ticker(1000000000ull / 60);
+	while (true)
+	{
+		x += dx;
+		y += dy;
+		if (x < 0 || x > range_x)
+			dx = -dx;
+		if (y < 0 || y > range_y)
+			dy = -dy;
+		XMoveWindow(display, window, x, y);
+		XPutImage(display, window, gc, image, 0, 0, 0, 0, DRAG_WIDTH, DRAG_HEIGHT);
+		XFlush(display);
+		ticker.Wait();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		printf("usage: workload <idle|cursor|terminal|noise|drag>\n");
+		return 1;
+	}
+	display = XOpenDisplay(nullptr);
+	if (display == nullptr)
+	{
+		printf("Could not open display\n");
+		return 1;
+	}
+	screen_width = DisplayWidth(display, 0);
+	screen_height = DisplayHeight(display, 0);
+
+	if (strcmp(argv[1], "idle") == 0)
+		Idle();
+	else if (strcmp(argv[1], "cursor") == 0)
+		BlinkingCursor();
+	else if (strcmp(argv[1], "terminal") == 0)
+		Terminal();
+	else if (strcmp(argv[1], "noise") == 0)
+		Noise();
+	else if (strcmp(argv[1], "drag") == 0)
+		Drag();
+	printf("unknown workload %s\n", argv[1]);
+	return 1;
+}
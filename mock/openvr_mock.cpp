@@ -0,0 +1,1017 @@
+// Stand-in for libopenvr_api.so so sinpin_vr can run without SteamVR (for example under Xvfb).
+// Only IVRSystem, IVROverlay and IVRInput exist, and only the parts the app uses do anything.
+//
+// Environment variables:
+//  SINPIN_MOCK_SCRIPT=<file>          poses and input to play back, see LoadScript()
+//  SINPIN_MOCK_LATENCY_US=<us>        time every interface call takes
+//  SINPIN_MOCK_LATENCY_US_<Method>=<us> overrides the latency of one method, eg. SINPIN_MOCK_LATENCY_US_SetOverlayTexture
+//  SINPIN_MOCK_STATS=<file>           per-method call counts and timings are written here as json
+//  SINPIN_MOCK_STATS_INTERVAL=<s>     also rewrite the stats file this often, for long runs
+#include "../lib/openvr.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <time.h>
+#include <vector>
+
+using namespace vr;
+
+const int MAX_METHODS = 256;
+const float DISPLAY_FREQUENCY = 90.0f;
+const float VSYNC_TO_PHOTONS = 0.011f;
+const TrackedDeviceIndex_t LEFT_HAND = 1;
+const TrackedDeviceIndex_t RIGHT_HAND = 2;
+const VRInputValueHandle_t LEFT_SOURCE = 1;
+const VRInputValueHandle_t RIGHT_SOURCE = 2;
+
+static uint64_t Now()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+// call statistics and latency injection
+
+struct MethodStats
+{
+	const char *name;
+	uint64_t latency;
+	uint64_t calls;
+	uint64_t total_time;
+	uint64_t max_time;
+};
+
+static MethodStats methods[MAX_METHODS];
+static int method_count = 0;
+static uint64_t frame_count = 0;
+static uint64_t start_time = 0;
+static const char *stats_path = nullptr;
+static uint64_t stats_interval = 0;
+static uint64_t last_stats_write = 0;
+
+static uint64_t LatencyFromEnv(const char *var, uint64_t fallback)
+{
+	const char *value = getenv(var);
+	if (value == nullptr)
+		return fallback;
+	return atof(value) * 1000.0;
+}
+
+static int RegisterMethod(const char *name)
+{
+	if (method_count == MAX_METHODS)
+	{
+		printf("mock: too many methods\n");
+		abort();
+	}
+	char var[128];
+	snprintf(var, sizeof(var), "SINPIN_MOCK_LATENCY_US_%s", name);
+	MethodStats &method = methods[method_count];
+	method.name = name;
+	method.latency = LatencyFromEnv(var, LatencyFromEnv("SINPIN_MOCK_LATENCY_US", 0));
+	return method_count++;
+}
+
+class MockCall
+{
+  public:
+	MockCall(int method) : _method(method), _start(Now())
+	{
+	}
+	~MockCall()
+	{
+		MethodStats &method = methods[_method];
+		if (method.latency)
+		{
+			// blocking like a real IPC round trip would, instead of spinning
+			uint64_t until = _start + method.latency;
+			timespec t{(time_t)(until / 1000000000), (long)(until % 1000000000)};
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, nullptr))
+				;
+		}
+		uint64_t duration = Now() - _start;
+		method.calls++;
+		method.total_time += duration;
+		if (duration > method.max_time)
+			method.max_time = duration;
+	}
+
+  private:
+	int _method;
+	uint64_t _start;
+};
+
+#define MOCK_CALL()                                                                                                    \
+	static int _mock_method = RegisterMethod(__func__);                                                                \
+	MockCall _mock_call(_mock_method)
+
+static void WriteStats()
+{
+	// written next to the target and renamed, so a reader polling the file never sees half of it
+	std::string tmp_path = std::string(stats_path) + ".tmp";
+	FILE *file = fopen(tmp_path.c_str(), "w");
+	if (file == nullptr)
+	{
+		printf("mock: could not write stats to %s\n", stats_path);
+		return;
+	}
+	uint64_t total_calls = 0;
+	for (int i = 0; i < method_count; i++)
+		total_calls += methods[i].calls;
+	double seconds = (Now() - start_time) / 1e9;
+	double frames = frame_count ? frame_count : 1;
+	fprintf(file, "{\"seconds\":%.3f,\"frames\":%lu,\"calls\":%lu,\"calls_per_frame\":%.3f,\"methods\":{", seconds, frame_count, total_calls, total_calls / frames);
+	for (int i = 0; i < method_count; i++)
+	{
+		const MethodStats &method = methods[i];
+		fprintf(file, "%s\n\"%s\":{\"calls\":%lu,\"calls_per_frame\":%.3f,\"total_us\":%.1f,\"mean_us\":%.3f,\"max_us\":%.1f}", i ? "," : "", method.name, method.calls, method.calls / frames, method.total_time / 1e3, method.calls ? method.total_time / 1e3 / method.calls : 0.0, method.max_time / 1e3);
+	}
+	fprintf(file, "\n}}\n");
+	fclose(file);
+	rename(tmp_path.c_str(), stats_path);
+}
+
+static void PrintStats()
+{
+	double frames = frame_count ? frame_count : 1;
+	printf("mock: %lu frames\n", frame_count);
+	printf("mock: %-44s %10s %10s %10s %10s\n", "method", "calls", "per frame", "mean us", "max us");
+	for (int i = 0; i < method_count; i++)
+	{
+		const MethodStats &method = methods[i];
+		printf("mock: %-44s %10lu %10.2f %10.2f %10.1f\n", method.name, method.calls, method.calls / frames, method.total_time / 1e3 / method.calls, method.max_time / 1e3);
+	}
+}
+
+// scripted poses and input
+
+struct DevicePose
+{
+	bool connected;
+	HmdMatrix34_t transform;
+};
+
+struct ActionValue
+{
+	bool state;
+	float x, y, z;
+};
+
+enum class ScriptEventType
+{
+	Pose,
+	Digital,
+	Analog,
+};
+
+struct ScriptEvent
+{
+	uint64_t frame;
+	ScriptEventType type;
+	TrackedDeviceIndex_t device;
+	VRActionHandle_t action;
+	VRInputValueHandle_t source;
+	HmdMatrix34_t transform;
+	ActionValue value;
+};
+
+static DevicePose devices[k_unMaxTrackedDeviceCount];
+static std::map<std::string, uint64_t> action_handles;
+static std::map<std::string, uint64_t> action_set_handles;
+static std::map<std::string, uint64_t> source_handles = {{"/user/hand/left", LEFT_SOURCE}, {"/user/hand/right", RIGHT_SOURCE}};
+// indexed by {action, source}
+static std::map<std::pair<VRActionHandle_t, VRInputValueHandle_t>, ActionValue> action_values;
+static std::map<std::pair<VRActionHandle_t, VRInputValueHandle_t>, ActionValue> last_action_values;
+static std::vector<ScriptEvent> script;
+static size_t script_pos = 0;
+static uint64_t script_loop = 0;
+static uint64_t haptic_count = 0;
+
+static uint64_t Handle(std::map<std::string, uint64_t> &handles, const char *path)
+{
+	auto [it, inserted] = handles.try_emplace(path, handles.size() + 1);
+	return it->second;
+}
+
+static HmdMatrix34_t PoseMatrix(float x, float y, float z, float yaw, float pitch, float roll)
+{
+	// rotation is yaw (around y), then pitch (around x), then roll (around z), in degrees
+	float a = yaw * M_PI / 180.0f, b = pitch * M_PI / 180.0f, c = roll * M_PI / 180.0f;
+	float ca = cosf(a), sa = sinf(a), cb = cosf(b), sb = sinf(b), cc = cosf(c), sc = sinf(c);
+	HmdMatrix34_t m = {{
+		{ca * cc + sa * sb * sc, -ca * sc + sa * sb * cc, sa * cb, x},
+		{cb * sc, cb * cc, -sb, y},
+		{-sa * cc + ca * sb * sc, sa * sc + ca * sb * cc, ca * cb, z},
+	}};
+	return m;
+}
+
+static void DefaultPoses()
+{
+	// standing in front of the origin with both hands pointing forward, where the panels start out
+	devices[k_unTrackedDeviceIndex_Hmd] = {true, PoseMatrix(0, 1.6f, 1.0f, 0, 0, 0)};
+	devices[LEFT_HAND] = {true, PoseMatrix(-0.2f, 1.2f, 0.5f, 0, 0, 0)};
+	devices[RIGHT_HAND] = {true, PoseMatrix(0.2f, 1.2f, 0.5f, 0, 0, 0)};
+}
+
+static TrackedDeviceIndex_t ParseDevice(const char *name)
+{
+	if (strcmp(name, "hmd") == 0)
+		return k_unTrackedDeviceIndex_Hmd;
+	if (strcmp(name, "left") == 0)
+		return LEFT_HAND;
+	if (strcmp(name, "right") == 0)
+		return RIGHT_HAND;
+	return k_unTrackedDeviceIndexInvalid;
+}
+
+// Script lines, events apply from the given frame (counted in UpdateActionState calls) onwards:
+//  <frame> pose <hmd|left|right> <x> <y> <z> <yaw> <pitch> <roll>
+//  <frame> digital <action path> <left|right> <0|1>
+//  <frame> analog <action path> <left|right> <x> [y] [z]
+//  loop <frames>
+// Empty lines and lines starting with # are ignored.
+static bool LoadScript(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (file == nullptr)
+	{
+		printf("mock: could not open script %s\n", path);
+		return false;
+	}
+	char line[512];
+	int line_number = 0;
+	while (fgets(line, sizeof(line), file))
+	{
+		line_number++;
+		char type[16], arg[256], hand[16];
+		ScriptEvent event{};
+		int n = sscanf(line, "%15s", type);
+		if (n != 1 || type[0] == '#')
+			continue;
+		if (strcmp(type, "loop") == 0)
+		{
+			if (sscanf(line, "loop %lu", &script_loop) == 1)
+				continue;
+		}
+		else if (sscanf(line, "%lu %15s", &event.frame, type) == 2)
+		{
+			float v[6];
+			if (strcmp(type, "pose") == 0 && sscanf(line, "%*u pose %15s %f %f %f %f %f %f", hand, v, v + 1, v + 2, v + 3, v + 4, v + 5) == 7)
+			{
+				event.type = ScriptEventType::Pose;
+				event.device = ParseDevice(hand);
+				event.transform = PoseMatrix(v[0], v[1], v[2], v[3], v[4], v[5]);
+				if (event.device != k_unTrackedDeviceIndexInvalid)
+				{
+					script.push_back(event);
+					continue;
+				}
+			}
+			else if (strcmp(type, "digital") == 0 && sscanf(line, "%*u digital %255s %15s %f", arg, hand, v) == 3)
+			{
+				event.type = ScriptEventType::Digital;
+				event.action = Handle(action_handles, arg);
+				event.source = ParseDevice(hand) == LEFT_HAND ? LEFT_SOURCE : RIGHT_SOURCE;
+				event.value.state = v[0] != 0;
+				script.push_back(event);
+				continue;
+			}
+			else if (strcmp(type, "analog") == 0 && (n = sscanf(line, "%*u analog %255s %15s %f %f %f", arg, hand, v, v + 1, v + 2)) >= 3)
+			{
+				event.type = ScriptEventType::Analog;
+				event.action = Handle(action_handles, arg);
+				event.source = ParseDevice(hand) == LEFT_HAND ? LEFT_SOURCE : RIGHT_SOURCE;
+				event.value = {false, v[0], n > 3 ? v[1] : 0, n > 4 ? v[2] : 0};
+				script.push_back(event);
+				continue;
+			}
+		}
+		printf("mock: %s:%d: could not parse '%s'\n", path, line_number, strtok(line, "\n"));
+		fclose(file);
+		return false;
+	}
+	fclose(file);
+	std::stable_sort(script.begin(), script.end(), [](const ScriptEvent &a, const ScriptEvent &b) { return a.frame < b.frame; });
+	printf("mock: loaded %zu script events from %s\n", script.size(), path);
+	return true;
+}
+
+static void AdvanceScript()
+{
+	uint64_t frame = frame_count;
+	if (script_loop)
+	{
+		frame %= script_loop;
+		if (frame == 0)
+			script_pos = 0;
+	}
+	while (script_pos < script.size() && script[script_pos].frame <= frame)
+	{
+		const ScriptEvent &event = script[script_pos++];
+		switch (event.type)
+		{
+		case ScriptEventType::Pose:
+			devices[event.device] = {true, event.transform};
+			break;
+		case ScriptEventType::Digital:
+		case ScriptEventType::Analog:
+			action_values[{event.action, event.source}] = event.value;
+			break;
+		}
+	}
+}
+
+static ActionValue GetValue(const std::map<std::pair<VRActionHandle_t, VRInputValueHandle_t>, ActionValue> &values, VRActionHandle_t action, VRInputValueHandle_t source)
+{
+	if (source == k_ulInvalidInputValueHandle)
+	{
+		// any device, the first one that is doing something wins
+		for (auto s : {LEFT_SOURCE, RIGHT_SOURCE})
+		{
+			ActionValue value = GetValue(values, action, s);
+			if (value.state || value.x || value.y || value.z)
+				return value;
+		}
+		return {};
+	}
+	auto it = values.find({action, source});
+	return it == values.end() ? ActionValue{} : it->second;
+}
+
+// overlays
+
+// this SDK version has no VROverlayTransformType for overlay relative transforms
+enum class TransformType
+{
+	Absolute,
+	TrackedDeviceRelative,
+	OverlayRelative,
+};
+
+struct MockOverlay
+{
+	std::string key;
+	std::string name;
+	bool visible = false;
+	uint32_t flags = 0;
+	float color[3] = {1, 1, 1};
+	float alpha = 1;
+	uint32_t sort_order = 0;
+	float width = 1;
+	VRTextureBounds_t bounds = {0, 0, 1, 1};
+	TransformType transform_type = TransformType::Absolute;
+	ETrackingUniverseOrigin origin = TrackingUniverseStanding;
+	TrackedDeviceIndex_t device = k_unTrackedDeviceIndexInvalid;
+	VROverlayHandle_t parent = k_ulOverlayHandleInvalid;
+	HmdMatrix34_t transform = {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}}};
+	bool has_cursor = false;
+	HmdVector2_t cursor = {};
+	Texture_t texture = {};
+	uint64_t texture_updates = 0;
+};
+
+static std::map<VROverlayHandle_t, MockOverlay> overlays;
+static VROverlayHandle_t next_overlay = 1;
+
+static MockOverlay *Find(VROverlayHandle_t handle)
+{
+	auto it = overlays.find(handle);
+	return it == overlays.end() ? nullptr : &it->second;
+}
+
+#define FIND_OVERLAY(handle)                                                                                           \
+	MockOverlay *overlay = Find(handle);                                                                               \
+	if (overlay == nullptr)                                                                                            \
+	return VROverlayError_UnknownOverlay
+
+class MockSystem : public IVRSystem
+{
+  public:
+	bool GetTimeSinceLastVsync(float *pfSecondsSinceLastVsync, uint64_t *pulFrameCounter) override
+	{
+		MOCK_CALL();
+		double since_start = (Now() - start_time) / 1e9;
+		double frames = since_start * DISPLAY_FREQUENCY;
+		if (pfSecondsSinceLastVsync)
+			*pfSecondsSinceLastVsync = (frames - floor(frames)) / DISPLAY_FREQUENCY;
+		if (pulFrameCounter)
+			*pulFrameCounter = frames;
+		return true;
+	}
+	void GetDeviceToAbsoluteTrackingPose(ETrackingUniverseOrigin eOrigin, float fPredictedSecondsToPhotonsFromNow, TrackedDevicePose_t *pTrackedDevicePoseArray, uint32_t unTrackedDevicePoseArrayCount) override
+	{
+		MOCK_CALL();
+		for (uint32_t i = 0; i < unTrackedDevicePoseArrayCount && i < k_unMaxTrackedDeviceCount; i++)
+		{
+			TrackedDevicePose_t &pose = pTrackedDevicePoseArray[i];
+			pose = {};
+			pose.bDeviceIsConnected = devices[i].connected;
+			pose.bPoseIsValid = devices[i].connected;
+			pose.eTrackingResult = devices[i].connected ? TrackingResult_Running_OK : TrackingResult_Uninitialized;
+			pose.mDeviceToAbsoluteTracking = devices[i].transform;
+		}
+	}
+	uint32_t GetSortedTrackedDeviceIndicesOfClass(ETrackedDeviceClass eTrackedDeviceClass, vr::TrackedDeviceIndex_t *punTrackedDeviceIndexArray, uint32_t unTrackedDeviceIndexArrayCount, vr::TrackedDeviceIndex_t unRelativeToTrackedDeviceIndex) override
+	{
+		MOCK_CALL();
+		uint32_t count = 0;
+		for (TrackedDeviceIndex_t i = 0; i < k_unMaxTrackedDeviceCount; i++)
+		{
+			if (devices[i].connected && DeviceClass(i) == eTrackedDeviceClass)
+			{
+				if (count < unTrackedDeviceIndexArrayCount)
+					punTrackedDeviceIndexArray[count] = i;
+				count++;
+			}
+		}
+		return count;
+	}
+	vr::TrackedDeviceIndex_t GetTrackedDeviceIndexForControllerRole(vr::ETrackedControllerRole unDeviceType) override
+	{
+		MOCK_CALL();
+		if (unDeviceType == TrackedControllerRole_LeftHand)
+			return LEFT_HAND;
+		if (unDeviceType == TrackedControllerRole_RightHand)
+			return RIGHT_HAND;
+		return k_unTrackedDeviceIndexInvalid;
+	}
+	ETrackedDeviceClass GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex) override
+	{
+		MOCK_CALL();
+		return DeviceClass(unDeviceIndex);
+	}
+	bool IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex) override
+	{
+		MOCK_CALL();
+		return unDeviceIndex < k_unMaxTrackedDeviceCount && devices[unDeviceIndex].connected;
+	}
+	float GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, ETrackedDeviceProperty prop, ETrackedPropertyError *pError) override
+	{
+		MOCK_CALL();
+		ETrackedPropertyError err = TrackedProp_Success;
+		float value = 0;
+		if (unDeviceIndex != k_unTrackedDeviceIndex_Hmd)
+			err = TrackedProp_UnknownProperty;
+		else if (prop == Prop_DisplayFrequency_Float)
+			value = DISPLAY_FREQUENCY;
+		else if (prop == Prop_SecondsFromVsyncToPhotons_Float)
+			value = VSYNC_TO_PHOTONS;
+		else
+			err = TrackedProp_UnknownProperty;
+		if (pError)
+			*pError = err;
+		return value;
+	}
+
+	// not used by sinpin_vr
+	void GetRecommendedRenderTargetSize(uint32_t *pnWidth, uint32_t *pnHeight) override { MOCK_CALL(); }
+	HmdMatrix44_t GetProjectionMatrix(EVREye eEye, float fNearZ, float fFarZ) override { MOCK_CALL(); return {}; }
+	void GetProjectionRaw(EVREye eEye, float *pfLeft, float *pfRight, float *pfTop, float *pfBottom) override { MOCK_CALL(); }
+	bool ComputeDistortion(EVREye eEye, float fU, float fV, DistortionCoordinates_t *pDistortionCoordinates) override { MOCK_CALL(); return {}; }
+	HmdMatrix34_t GetEyeToHeadTransform(EVREye eEye) override { MOCK_CALL(); return {}; }
+	int32_t GetD3D9AdapterIndex() override { MOCK_CALL(); return {}; }
+	void GetDXGIOutputInfo(int32_t *pnAdapterIndex) override { MOCK_CALL(); }
+	void GetOutputDevice(uint64_t *pnDevice, ETextureType textureType, VkInstance_T *pInstance) override { MOCK_CALL(); }
+	bool IsDisplayOnDesktop() override { MOCK_CALL(); return {}; }
+	bool SetDisplayVisibility(bool bIsVisibleOnDesktop) override { MOCK_CALL(); return {}; }
+	HmdMatrix34_t GetSeatedZeroPoseToStandingAbsoluteTrackingPose() override { MOCK_CALL(); return {}; }
+	HmdMatrix34_t GetRawZeroPoseToStandingAbsoluteTrackingPose() override { MOCK_CALL(); return {}; }
+	EDeviceActivityLevel GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId) override { MOCK_CALL(); return {}; }
+	void ApplyTransform(TrackedDevicePose_t *pOutputPose, const TrackedDevicePose_t *pTrackedDevicePose, const HmdMatrix34_t *pTransform) override { MOCK_CALL(); }
+	vr::ETrackedControllerRole GetControllerRoleForTrackedDeviceIndex(vr::TrackedDeviceIndex_t unDeviceIndex) override { MOCK_CALL(); return {}; }
+	bool GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, ETrackedDeviceProperty prop, ETrackedPropertyError *pError) override { MOCK_CALL(); return {}; }
+	int32_t GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, ETrackedDeviceProperty prop, ETrackedPropertyError *pError) override { MOCK_CALL(); return {}; }
+	uint64_t GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, ETrackedDeviceProperty prop, ETrackedPropertyError *pError) override { MOCK_CALL(); return {}; }
+	HmdMatrix34_t GetMatrix34TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, ETrackedDeviceProperty prop, ETrackedPropertyError *pError) override { MOCK_CALL(); return {}; }
+	uint32_t GetArrayTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, ETrackedDeviceProperty prop, PropertyTypeTag_t propType, void *pBuffer, uint32_t unBufferSize, ETrackedPropertyError *pError) override { MOCK_CALL(); return {}; }
+	uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, ETrackedDeviceProperty prop, char *pchValue, uint32_t unBufferSize, ETrackedPropertyError *pError) override { MOCK_CALL(); return {}; }
+	const char *GetPropErrorNameFromEnum(ETrackedPropertyError error) override { MOCK_CALL(); return {}; }
+	bool PollNextEvent(VREvent_t *pEvent, uint32_t uncbVREvent) override { MOCK_CALL(); return {}; }
+	bool PollNextEventWithPose(ETrackingUniverseOrigin eOrigin, VREvent_t *pEvent, uint32_t uncbVREvent, vr::TrackedDevicePose_t *pTrackedDevicePose) override { MOCK_CALL(); return {}; }
+	const char *GetEventTypeNameFromEnum(EVREventType eType) override { MOCK_CALL(); return {}; }
+	HiddenAreaMesh_t GetHiddenAreaMesh(EVREye eEye, EHiddenAreaMeshType type) override { MOCK_CALL(); return {}; }
+	bool GetControllerState(vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t *pControllerState, uint32_t unControllerStateSize) override { MOCK_CALL(); return {}; }
+	bool GetControllerStateWithPose(ETrackingUniverseOrigin eOrigin, vr::TrackedDeviceIndex_t unControllerDeviceIndex, vr::VRControllerState_t *pControllerState, uint32_t unControllerStateSize, TrackedDevicePose_t *pTrackedDevicePose) override { MOCK_CALL(); return {}; }
+	void TriggerHapticPulse(vr::TrackedDeviceIndex_t unControllerDeviceIndex, uint32_t unAxisId, unsigned short usDurationMicroSec) override { MOCK_CALL(); }
+	const char *GetButtonIdNameFromEnum(EVRButtonId eButtonId) override { MOCK_CALL(); return {}; }
+	const char *GetControllerAxisTypeNameFromEnum(EVRControllerAxisType eAxisType) override { MOCK_CALL(); return {}; }
+	bool IsInputAvailable() override { MOCK_CALL(); return {}; }
+	bool IsSteamVRDrawingControllers() override { MOCK_CALL(); return {}; }
+	bool ShouldApplicationPause() override { MOCK_CALL(); return {}; }
+	bool ShouldApplicationReduceRenderingWork() override { MOCK_CALL(); return {}; }
+	vr::EVRFirmwareError PerformFirmwareUpdate(vr::TrackedDeviceIndex_t unDeviceIndex) override { MOCK_CALL(); return {}; }
+	void AcknowledgeQuit_Exiting() override { MOCK_CALL(); }
+	uint32_t GetAppContainerFilePaths(char *pchBuffer, uint32_t unBufferSize) override { MOCK_CALL(); return {}; }
+	const char *GetRuntimeVersion() override { MOCK_CALL(); return {}; }
+
+  private:
+	static ETrackedDeviceClass DeviceClass(TrackedDeviceIndex_t index)
+	{
+		if (index == k_unTrackedDeviceIndex_Hmd)
+			return TrackedDeviceClass_HMD;
+		if (index == LEFT_HAND || index == RIGHT_HAND)
+			return TrackedDeviceClass_Controller;
+		return TrackedDeviceClass_Invalid;
+	}
+};
+
+class MockOverlayInterface : public IVROverlay
+{
+  public:
+	EVROverlayError FindOverlay(const char *pchOverlayKey, VROverlayHandle_t *pOverlayHandle) override
+	{
+		MOCK_CALL();
+		for (auto &[handle, overlay] : overlays)
+		{
+			if (overlay.key == pchOverlayKey)
+			{
+				*pOverlayHandle = handle;
+				return VROverlayError_None;
+			}
+		}
+		*pOverlayHandle = k_ulOverlayHandleInvalid;
+		return VROverlayError_UnknownOverlay;
+	}
+	EVROverlayError CreateOverlay(const char *pchOverlayKey, const char *pchOverlayName, VROverlayHandle_t *pOverlayHandle) override
+	{
+		MOCK_CALL();
+		for (auto &[handle, overlay] : overlays)
+		{
+			if (overlay.key == pchOverlayKey)
+				return VROverlayError_KeyInUse;
+		}
+		MockOverlay &overlay = overlays[next_overlay];
+		overlay.key = pchOverlayKey;
+		overlay.name = pchOverlayName;
+		*pOverlayHandle = next_overlay++;
+		return VROverlayError_None;
+	}
+	EVROverlayError DestroyOverlay(VROverlayHandle_t ulOverlayHandle) override
+	{
+		MOCK_CALL();
+		if (overlays.erase(ulOverlayHandle) == 0)
+			return VROverlayError_UnknownOverlay;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayFlag(VROverlayHandle_t ulOverlayHandle, VROverlayFlags eOverlayFlag, bool bEnabled) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		if (bEnabled)
+			overlay->flags |= eOverlayFlag;
+		else
+			overlay->flags &= ~eOverlayFlag;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayColor(VROverlayHandle_t ulOverlayHandle, float fRed, float fGreen, float fBlue) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->color[0] = fRed;
+		overlay->color[1] = fGreen;
+		overlay->color[2] = fBlue;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayAlpha(VROverlayHandle_t ulOverlayHandle, float fAlpha) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->alpha = fAlpha;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlaySortOrder(VROverlayHandle_t ulOverlayHandle, uint32_t unSortOrder) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->sort_order = unSortOrder;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayWidthInMeters(VROverlayHandle_t ulOverlayHandle, float fWidthInMeters) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		if (fWidthInMeters < 0)
+			return VROverlayError_InvalidParameter;
+		overlay->width = fWidthInMeters;
+		return VROverlayError_None;
+	}
+	EVROverlayError GetOverlayWidthInMeters(VROverlayHandle_t ulOverlayHandle, float *pfWidthInMeters) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		*pfWidthInMeters = overlay->width;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayTextureBounds(VROverlayHandle_t ulOverlayHandle, const VRTextureBounds_t *pOverlayTextureBounds) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->bounds = *pOverlayTextureBounds;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayTransformAbsolute(VROverlayHandle_t ulOverlayHandle, ETrackingUniverseOrigin eTrackingOrigin, const HmdMatrix34_t *pmatTrackingOriginToOverlayTransform) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->transform_type = TransformType::Absolute;
+		overlay->origin = eTrackingOrigin;
+		overlay->transform = *pmatTrackingOriginToOverlayTransform;
+		return VROverlayError_None;
+	}
+	EVROverlayError GetOverlayTransformAbsolute(VROverlayHandle_t ulOverlayHandle, ETrackingUniverseOrigin *peTrackingOrigin, HmdMatrix34_t *pmatTrackingOriginToOverlayTransform) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		if (overlay->transform_type != TransformType::Absolute)
+			return VROverlayError_InvalidParameter;
+		*peTrackingOrigin = overlay->origin;
+		*pmatTrackingOriginToOverlayTransform = overlay->transform;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayTransformTrackedDeviceRelative(VROverlayHandle_t ulOverlayHandle, TrackedDeviceIndex_t unTrackedDevice, const HmdMatrix34_t *pmatTrackedDeviceToOverlayTransform) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->transform_type = TransformType::TrackedDeviceRelative;
+		overlay->device = unTrackedDevice;
+		overlay->transform = *pmatTrackedDeviceToOverlayTransform;
+		return VROverlayError_None;
+	}
+	EVROverlayError GetOverlayTransformTrackedDeviceRelative(VROverlayHandle_t ulOverlayHandle, TrackedDeviceIndex_t *punTrackedDevice, HmdMatrix34_t *pmatTrackedDeviceToOverlayTransform) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		if (overlay->transform_type != TransformType::TrackedDeviceRelative)
+			return VROverlayError_InvalidParameter;
+		*punTrackedDevice = overlay->device;
+		*pmatTrackedDeviceToOverlayTransform = overlay->transform;
+		return VROverlayError_None;
+	}
+	vr::EVROverlayError GetOverlayTransformOverlayRelative(VROverlayHandle_t ulOverlayHandle, VROverlayHandle_t *ulOverlayHandleParent, HmdMatrix34_t *pmatParentOverlayToOverlayTransform) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		if (overlay->transform_type != TransformType::OverlayRelative)
+			return VROverlayError_InvalidParameter;
+		*ulOverlayHandleParent = overlay->parent;
+		*pmatParentOverlayToOverlayTransform = overlay->transform;
+		return VROverlayError_None;
+	}
+	vr::EVROverlayError SetOverlayTransformOverlayRelative(VROverlayHandle_t ulOverlayHandle, VROverlayHandle_t ulOverlayHandleParent, const HmdMatrix34_t *pmatParentOverlayToOverlayTransform) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		if (Find(ulOverlayHandleParent) == nullptr)
+			return VROverlayError_UnknownOverlay;
+		overlay->transform_type = TransformType::OverlayRelative;
+		overlay->parent = ulOverlayHandleParent;
+		overlay->transform = *pmatParentOverlayToOverlayTransform;
+		return VROverlayError_None;
+	}
+	EVROverlayError ShowOverlay(VROverlayHandle_t ulOverlayHandle) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->visible = true;
+		return VROverlayError_None;
+	}
+	EVROverlayError HideOverlay(VROverlayHandle_t ulOverlayHandle) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->visible = false;
+		return VROverlayError_None;
+	}
+	bool IsOverlayVisible(VROverlayHandle_t ulOverlayHandle) override
+	{
+		MOCK_CALL();
+		MockOverlay *overlay = Find(ulOverlayHandle);
+		return overlay && overlay->visible;
+	}
+	EVROverlayError SetOverlayCursorPositionOverride(VROverlayHandle_t ulOverlayHandle, const HmdVector2_t *pvCursor) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->has_cursor = true;
+		overlay->cursor = *pvCursor;
+		return VROverlayError_None;
+	}
+	EVROverlayError ClearOverlayCursorPositionOverride(VROverlayHandle_t ulOverlayHandle) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->has_cursor = false;
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayTexture(VROverlayHandle_t ulOverlayHandle, const Texture_t *pTexture) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->texture = *pTexture;
+		overlay->texture_updates++;
+		return VROverlayError_None;
+	}
+	EVROverlayError ClearOverlayTexture(VROverlayHandle_t ulOverlayHandle) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		overlay->texture = {};
+		return VROverlayError_None;
+	}
+	EVROverlayError SetOverlayRaw(VROverlayHandle_t ulOverlayHandle, void *pvBuffer, uint32_t unWidth, uint32_t unHeight, uint32_t unBytesPerPixel) override
+	{
+		MOCK_CALL();
+		FIND_OVERLAY(ulOverlayHandle);
+		if (pvBuffer == nullptr || unBytesPerPixel == 0 || unBytesPerPixel > 4)
+			return VROverlayError_InvalidParameter;
+		overlay->texture = {};
+		overlay->texture_updates++;
+		return VROverlayError_None;
+	}
+
+	// not used by sinpin_vr
+	uint32_t GetOverlayKey(VROverlayHandle_t ulOverlayHandle, char *pchValue, uint32_t unBufferSize, EVROverlayError *pError) override { MOCK_CALL(); return {}; }
+	uint32_t GetOverlayName(VROverlayHandle_t ulOverlayHandle, char *pchValue, uint32_t unBufferSize, EVROverlayError *pError) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayName(VROverlayHandle_t ulOverlayHandle, const char *pchName) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayImageData(VROverlayHandle_t ulOverlayHandle, void *pvBuffer, uint32_t unBufferSize, uint32_t *punWidth, uint32_t *punHeight) override { MOCK_CALL(); return {}; }
+	const char *GetOverlayErrorNameFromEnum(EVROverlayError error) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayRenderingPid(VROverlayHandle_t ulOverlayHandle, uint32_t unPID) override { MOCK_CALL(); return {}; }
+	uint32_t GetOverlayRenderingPid(VROverlayHandle_t ulOverlayHandle) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayFlag(VROverlayHandle_t ulOverlayHandle, VROverlayFlags eOverlayFlag, bool *pbEnabled) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayFlags(VROverlayHandle_t ulOverlayHandle, uint32_t *pFlags) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayColor(VROverlayHandle_t ulOverlayHandle, float *pfRed, float *pfGreen, float *pfBlue) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayAlpha(VROverlayHandle_t ulOverlayHandle, float *pfAlpha) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayTexelAspect(VROverlayHandle_t ulOverlayHandle, float fTexelAspect) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayTexelAspect(VROverlayHandle_t ulOverlayHandle, float *pfTexelAspect) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlaySortOrder(VROverlayHandle_t ulOverlayHandle, uint32_t *punSortOrder) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayCurvature(VROverlayHandle_t ulOverlayHandle, float fCurvature) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayCurvature(VROverlayHandle_t ulOverlayHandle, float *pfCurvature) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayPreCurvePitch(VROverlayHandle_t ulOverlayHandle, float fRadians) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayPreCurvePitch(VROverlayHandle_t ulOverlayHandle, float *pfRadians) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayTextureColorSpace(VROverlayHandle_t ulOverlayHandle, EColorSpace eTextureColorSpace) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayTextureColorSpace(VROverlayHandle_t ulOverlayHandle, EColorSpace *peTextureColorSpace) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayTextureBounds(VROverlayHandle_t ulOverlayHandle, VRTextureBounds_t *pOverlayTextureBounds) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayTransformType(VROverlayHandle_t ulOverlayHandle, VROverlayTransformType *peTransformType) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayTransformTrackedDeviceComponent(VROverlayHandle_t ulOverlayHandle, TrackedDeviceIndex_t unDeviceIndex, const char *pchComponentName) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayTransformTrackedDeviceComponent(VROverlayHandle_t ulOverlayHandle, TrackedDeviceIndex_t *punDeviceIndex, char *pchComponentName, uint32_t unComponentNameSize) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayTransformCursor(VROverlayHandle_t ulCursorOverlayHandle, const HmdVector2_t *pvHotspot) override { MOCK_CALL(); return {}; }
+	vr::EVROverlayError GetOverlayTransformCursor(VROverlayHandle_t ulOverlayHandle, HmdVector2_t *pvHotspot) override { MOCK_CALL(); return {}; }
+	vr::EVROverlayError SetOverlayTransformProjection(VROverlayHandle_t ulOverlayHandle, ETrackingUniverseOrigin eTrackingOrigin, const HmdMatrix34_t *pmatTrackingOriginToOverlayTransform, const VROverlayProjection_t *pProjection, vr::EVREye eEye) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetTransformForOverlayCoordinates(VROverlayHandle_t ulOverlayHandle, ETrackingUniverseOrigin eTrackingOrigin, HmdVector2_t coordinatesInOverlay, HmdMatrix34_t *pmatTransform) override { MOCK_CALL(); return {}; }
+	EVROverlayError WaitFrameSync(uint32_t nTimeoutMs) override { MOCK_CALL(); return {}; }
+	bool PollNextOverlayEvent(VROverlayHandle_t ulOverlayHandle, VREvent_t *pEvent, uint32_t uncbVREvent) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayInputMethod(VROverlayHandle_t ulOverlayHandle, VROverlayInputMethod *peInputMethod) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayInputMethod(VROverlayHandle_t ulOverlayHandle, VROverlayInputMethod eInputMethod) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayMouseScale(VROverlayHandle_t ulOverlayHandle, HmdVector2_t *pvecMouseScale) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayMouseScale(VROverlayHandle_t ulOverlayHandle, const HmdVector2_t *pvecMouseScale) override { MOCK_CALL(); return {}; }
+	bool ComputeOverlayIntersection(VROverlayHandle_t ulOverlayHandle, const VROverlayIntersectionParams_t *pParams, VROverlayIntersectionResults_t *pResults) override { MOCK_CALL(); return {}; }
+	bool IsHoverTargetOverlay(VROverlayHandle_t ulOverlayHandle) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayIntersectionMask(VROverlayHandle_t ulOverlayHandle, VROverlayIntersectionMaskPrimitive_t *pMaskPrimitives, uint32_t unNumMaskPrimitives, uint32_t unPrimitiveSize) override { MOCK_CALL(); return {}; }
+	EVROverlayError TriggerLaserMouseHapticVibration(VROverlayHandle_t ulOverlayHandle, float fDurationSeconds, float fFrequency, float fAmplitude) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayCursor(VROverlayHandle_t ulOverlayHandle, VROverlayHandle_t ulCursorHandle) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetOverlayFromFile(VROverlayHandle_t ulOverlayHandle, const char *pchFilePath) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayTexture(VROverlayHandle_t ulOverlayHandle, void **pNativeTextureHandle, void *pNativeTextureRef, uint32_t *pWidth, uint32_t *pHeight, uint32_t *pNativeFormat, ETextureType *pAPIType, EColorSpace *pColorSpace, VRTextureBounds_t *pTextureBounds) override { MOCK_CALL(); return {}; }
+	EVROverlayError ReleaseNativeOverlayHandle(VROverlayHandle_t ulOverlayHandle, void *pNativeTextureHandle) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetOverlayTextureSize(VROverlayHandle_t ulOverlayHandle, uint32_t *pWidth, uint32_t *pHeight) override { MOCK_CALL(); return {}; }
+	EVROverlayError CreateDashboardOverlay(const char *pchOverlayKey, const char *pchOverlayFriendlyName, VROverlayHandle_t *pMainHandle, VROverlayHandle_t *pThumbnailHandle) override { MOCK_CALL(); return {}; }
+	bool IsDashboardVisible() override { MOCK_CALL(); return {}; }
+	bool IsActiveDashboardOverlay(VROverlayHandle_t ulOverlayHandle) override { MOCK_CALL(); return {}; }
+	EVROverlayError SetDashboardOverlaySceneProcess(VROverlayHandle_t ulOverlayHandle, uint32_t unProcessId) override { MOCK_CALL(); return {}; }
+	EVROverlayError GetDashboardOverlaySceneProcess(VROverlayHandle_t ulOverlayHandle, uint32_t *punProcessId) override { MOCK_CALL(); return {}; }
+	void ShowDashboard(const char *pchOverlayToShow) override { MOCK_CALL(); }
+	vr::TrackedDeviceIndex_t GetPrimaryDashboardDevice() override { MOCK_CALL(); return {}; }
+	EVROverlayError ShowKeyboard(EGamepadTextInputMode eInputMode, EGamepadTextInputLineMode eLineInputMode, uint32_t unFlags, const char *pchDescription, uint32_t unCharMax, const char *pchExistingText, uint64_t uUserValue) override { MOCK_CALL(); return {}; }
+	EVROverlayError ShowKeyboardForOverlay(VROverlayHandle_t ulOverlayHandle, EGamepadTextInputMode eInputMode, EGamepadTextInputLineMode eLineInputMode, uint32_t unFlags, const char *pchDescription, uint32_t unCharMax, const char *pchExistingText, uint64_t uUserValue) override { MOCK_CALL(); return {}; }
+	uint32_t GetKeyboardText(char *pchText, uint32_t cchText) override { MOCK_CALL(); return {}; }
+	void HideKeyboard() override { MOCK_CALL(); }
+	void SetKeyboardTransformAbsolute(ETrackingUniverseOrigin eTrackingOrigin, const HmdMatrix34_t *pmatTrackingOriginToKeyboardTransform) override { MOCK_CALL(); }
+	void SetKeyboardPositionForOverlay(VROverlayHandle_t ulOverlayHandle, HmdRect2_t avoidRect) override { MOCK_CALL(); }
+	VRMessageOverlayResponse ShowMessageOverlay(const char *pchText, const char *pchCaption, const char *pchButton0Text, const char *pchButton1Text, const char *pchButton2Text, const char *pchButton3Text) override { MOCK_CALL(); return {}; }
+	void CloseMessageOverlay() override { MOCK_CALL(); }
+};
+
+class MockInput : public IVRInput
+{
+  public:
+	EVRInputError SetActionManifestPath(const char *pchActionManifestPath) override
+	{
+		MOCK_CALL();
+		// the manifest is not parsed, every action path is accepted
+		FILE *file = fopen(pchActionManifestPath, "r");
+		if (file == nullptr)
+			return VRInputError_MismatchedActionManifest;
+		fclose(file);
+		return VRInputError_None;
+	}
+	EVRInputError GetActionSetHandle(const char *pchActionSetName, VRActionSetHandle_t *pHandle) override
+	{
+		MOCK_CALL();
+		*pHandle = Handle(action_set_handles, pchActionSetName);
+		return VRInputError_None;
+	}
+	EVRInputError GetActionHandle(const char *pchActionName, VRActionHandle_t *pHandle) override
+	{
+		MOCK_CALL();
+		*pHandle = Handle(action_handles, pchActionName);
+		return VRInputError_None;
+	}
+	EVRInputError GetInputSourceHandle(const char *pchInputSourcePath, VRInputValueHandle_t *pHandle) override
+	{
+		MOCK_CALL();
+		*pHandle = Handle(source_handles, pchInputSourcePath);
+		return VRInputError_None;
+	}
+	EVRInputError UpdateActionState(VRActiveActionSet_t *pSets, uint32_t unSizeOfVRSelectedActionSet_t, uint32_t unSetCount) override
+	{
+		MOCK_CALL();
+		if (unSizeOfVRSelectedActionSet_t != sizeof(VRActiveActionSet_t))
+			return VRInputError_WrongType;
+		// the app calls this once per frame, so it is what the script and the stats count frames by
+		last_action_values = action_values;
+		AdvanceScript();
+		frame_count++;
+		if (stats_path && stats_interval && Now() - last_stats_write > stats_interval)
+		{
+			WriteStats();
+			last_stats_write = Now();
+		}
+		return VRInputError_None;
+	}
+	EVRInputError GetDigitalActionData(VRActionHandle_t action, InputDigitalActionData_t *pActionData, uint32_t unActionDataSize, VRInputValueHandle_t ulRestrictToDevice) override
+	{
+		MOCK_CALL();
+		if (unActionDataSize != sizeof(InputDigitalActionData_t))
+			return VRInputError_WrongType;
+		ActionValue value = GetValue(action_values, action, ulRestrictToDevice);
+		ActionValue last = GetValue(last_action_values, action, ulRestrictToDevice);
+		*pActionData = {};
+		pActionData->bActive = true;
+		pActionData->activeOrigin = ulRestrictToDevice;
+		pActionData->bState = value.state;
+		pActionData->bChanged = value.state != last.state;
+		return VRInputError_None;
+	}
+	EVRInputError GetAnalogActionData(VRActionHandle_t action, InputAnalogActionData_t *pActionData, uint32_t unActionDataSize, VRInputValueHandle_t ulRestrictToDevice) override
+	{
+		MOCK_CALL();
+		if (unActionDataSize != sizeof(InputAnalogActionData_t))
+			return VRInputError_WrongType;
+		ActionValue value = GetValue(action_values, action, ulRestrictToDevice);
+		ActionValue last = GetValue(last_action_values, action, ulRestrictToDevice);
+		*pActionData = {};
+		pActionData->bActive = true;
+		pActionData->activeOrigin = ulRestrictToDevice;
+		pActionData->x = value.x;
+		pActionData->y = value.y;
+		pActionData->z = value.z;
+		pActionData->deltaX = value.x - last.x;
+		pActionData->deltaY = value.y - last.y;
+		pActionData->deltaZ = value.z - last.z;
+		return VRInputError_None;
+	}
+	EVRInputError TriggerHapticVibrationAction(VRActionHandle_t action, float fStartSecondsFromNow, float fDurationSeconds, float fFrequency, float fAmplitude, VRInputValueHandle_t ulRestrictToDevice) override
+	{
+		MOCK_CALL();
+		haptic_count++;
+		return VRInputError_None;
+	}
+
+	// not used by sinpin_vr
+	EVRInputError GetPoseActionDataRelativeToNow(VRActionHandle_t action, ETrackingUniverseOrigin eOrigin, float fPredictedSecondsFromNow, InputPoseActionData_t *pActionData, uint32_t unActionDataSize, VRInputValueHandle_t ulRestrictToDevice) override { MOCK_CALL(); return {}; }
+	EVRInputError GetPoseActionDataForNextFrame(VRActionHandle_t action, ETrackingUniverseOrigin eOrigin, InputPoseActionData_t *pActionData, uint32_t unActionDataSize, VRInputValueHandle_t ulRestrictToDevice) override { MOCK_CALL(); return {}; }
+	EVRInputError GetSkeletalActionData(VRActionHandle_t action, InputSkeletalActionData_t *pActionData, uint32_t unActionDataSize) override { MOCK_CALL(); return {}; }
+	EVRInputError GetDominantHand(ETrackedControllerRole *peDominantHand) override { MOCK_CALL(); return {}; }
+	EVRInputError SetDominantHand(ETrackedControllerRole eDominantHand) override { MOCK_CALL(); return {}; }
+	EVRInputError GetBoneCount(VRActionHandle_t action, uint32_t *pBoneCount) override { MOCK_CALL(); return {}; }
+	EVRInputError GetBoneHierarchy(VRActionHandle_t action, BoneIndex_t *pParentIndices, uint32_t unIndexArayCount) override { MOCK_CALL(); return {}; }
+	EVRInputError GetBoneName(VRActionHandle_t action, BoneIndex_t nBoneIndex, char *pchBoneName, uint32_t unNameBufferSize) override { MOCK_CALL(); return {}; }
+	EVRInputError GetSkeletalReferenceTransforms(VRActionHandle_t action, EVRSkeletalTransformSpace eTransformSpace, EVRSkeletalReferencePose eReferencePose, VRBoneTransform_t *pTransformArray, uint32_t unTransformArrayCount) override { MOCK_CALL(); return {}; }
+	EVRInputError GetSkeletalTrackingLevel(VRActionHandle_t action, EVRSkeletalTrackingLevel *pSkeletalTrackingLevel) override { MOCK_CALL(); return {}; }
+	EVRInputError GetSkeletalBoneData(VRActionHandle_t action, EVRSkeletalTransformSpace eTransformSpace, EVRSkeletalMotionRange eMotionRange, VRBoneTransform_t *pTransformArray, uint32_t unTransformArrayCount) override { MOCK_CALL(); return {}; }
+	EVRInputError GetSkeletalSummaryData(VRActionHandle_t action, EVRSummaryType eSummaryType, VRSkeletalSummaryData_t *pSkeletalSummaryData) override { MOCK_CALL(); return {}; }
+	EVRInputError GetSkeletalBoneDataCompressed(VRActionHandle_t action, EVRSkeletalMotionRange eMotionRange, void *pvCompressedData, uint32_t unCompressedSize, uint32_t *punRequiredCompressedSize) override { MOCK_CALL(); return {}; }
+	EVRInputError DecompressSkeletalBoneData(const void *pvCompressedBuffer, uint32_t unCompressedBufferSize, EVRSkeletalTransformSpace eTransformSpace, VRBoneTransform_t *pTransformArray, uint32_t unTransformArrayCount) override { MOCK_CALL(); return {}; }
+	EVRInputError GetActionOrigins(VRActionSetHandle_t actionSetHandle, VRActionHandle_t digitalActionHandle, VRInputValueHandle_t *originsOut, uint32_t originOutCount) override { MOCK_CALL(); return {}; }
+	EVRInputError GetOriginLocalizedName(VRInputValueHandle_t origin, char *pchNameArray, uint32_t unNameArraySize, int32_t unStringSectionsToInclude) override { MOCK_CALL(); return {}; }
+	EVRInputError GetOriginTrackedDeviceInfo(VRInputValueHandle_t origin, InputOriginInfo_t *pOriginInfo, uint32_t unOriginInfoSize) override { MOCK_CALL(); return {}; }
+	EVRInputError GetActionBindingInfo(VRActionHandle_t action, InputBindingInfo_t *pOriginInfo, uint32_t unBindingInfoSize, uint32_t unBindingInfoCount, uint32_t *punReturnedBindingInfoCount) override { MOCK_CALL(); return {}; }
+	EVRInputError ShowActionOrigins(VRActionSetHandle_t actionSetHandle, VRActionHandle_t ulActionHandle) override { MOCK_CALL(); return {}; }
+	EVRInputError ShowBindingsForActionSet(VRActiveActionSet_t *pSets, uint32_t unSizeOfVRSelectedActionSet_t, uint32_t unSetCount, VRInputValueHandle_t originToHighlight) override { MOCK_CALL(); return {}; }
+	EVRInputError GetComponentStateForBinding(const char *pchRenderModelName, const char *pchComponentName, const InputBindingInfo_t *pOriginInfo, uint32_t unBindingInfoSize, uint32_t unBindingInfoCount, vr::RenderModel_ComponentState_t *pComponentState) override { MOCK_CALL(); return {}; }
+	bool IsUsingLegacyInput() override { MOCK_CALL(); return {}; }
+	EVRInputError OpenBindingUI(const char *pchAppKey, VRActionSetHandle_t ulActionSetHandle, VRInputValueHandle_t ulDeviceHandle, bool bShowOnDesktop) override { MOCK_CALL(); return {}; }
+	EVRInputError GetBindingVariant(vr::VRInputValueHandle_t ulDevicePath, char *pchVariantArray, uint32_t unVariantArraySize) override { MOCK_CALL(); return {}; }
+};
+
+static MockSystem mock_system;
+static MockOverlayInterface mock_overlay;
+static MockInput mock_input;
+static uint32_t init_token = 0;
+
+static void Reset()
+{
+	overlays.clear();
+	next_overlay = 1;
+	action_values.clear();
+	last_action_values.clear();
+	script.clear();
+	script_pos = 0;
+	script_loop = 0;
+	for (auto &device : devices)
+		device = {};
+	frame_count = 0;
+	haptic_count = 0;
+	for (int i = 0; i < method_count; i++)
+		methods[i].calls = methods[i].total_time = methods[i].max_time = 0;
+}
+
+// library entry points, see the bottom of openvr.h
+
+VR_INTERFACE uint32_t VR_CALLTYPE VR_InitInternal2(EVRInitError *peError, EVRApplicationType eApplicationType, const char *pStartupInfo)
+{
+	Reset();
+	start_time = Now();
+	last_stats_write = start_time;
+	DefaultPoses();
+	const char *script_path = getenv("SINPIN_MOCK_SCRIPT");
+	if (script_path && !LoadScript(script_path))
+	{
+		*peError = VRInitError_Init_InvalidApplicationType;
+		return 0;
+	}
+	stats_path = getenv("SINPIN_MOCK_STATS");
+	const char *interval = getenv("SINPIN_MOCK_STATS_INTERVAL");
+	stats_interval = interval ? atof(interval) * 1e9 : 0;
+	printf("mock: OpenVR runtime stand-in initialised\n");
+	*peError = VRInitError_None;
+	return ++init_token;
+}
+
+VR_INTERFACE void VR_CALLTYPE VR_ShutdownInternal()
+{
+	PrintStats();
+	printf("mock: %zu overlays left, %lu haptic pulses\n", overlays.size(), haptic_count);
+	if (stats_path)
+		WriteStats();
+}
+
+VR_INTERFACE void *VR_CALLTYPE VR_GetGenericInterface(const char *pchInterfaceVersion, EVRInitError *peError)
+{
+	void *interface = nullptr;
+	if (strcmp(pchInterfaceVersion, IVRSystem_Version) == 0)
+		interface = static_cast<IVRSystem *>(&mock_system);
+	else if (strcmp(pchInterfaceVersion, IVROverlay_Version) == 0)
+		interface = static_cast<IVROverlay *>(&mock_overlay);
+	else if (strcmp(pchInterfaceVersion, IVRInput_Version) == 0)
+		interface = static_cast<IVRInput *>(&mock_input);
+	if (peError)
+		*peError = interface ? VRInitError_None : VRInitError_Init_InterfaceNotFound;
+	return interface;
+}
+
+VR_INTERFACE bool VR_CALLTYPE VR_IsInterfaceVersionValid(const char *pchInterfaceVersion)
+{
+	EVRInitError err;
+	return VR_GetGenericInterface(pchInterfaceVersion, &err) != nullptr;
+}
+
+VR_INTERFACE uint32_t VR_CALLTYPE VR_GetInitToken()
+{
+	return init_token;
+}
+
+VR_INTERFACE bool VR_CALLTYPE VR_IsHmdPresent()
+{
+	return true;
+}
+
+VR_INTERFACE bool VR_CALLTYPE VR_IsRuntimeInstalled()
+{
+	return true;
+}
+
+VR_INTERFACE bool VR_GetRuntimePath(char *pchPathBuffer, uint32_t unBufferSize, uint32_t *punRequiredBufferSize)
+{
+	const char *path = "mock";
+	*punRequiredBufferSize = strlen(path) + 1;
+	if (unBufferSize < *punRequiredBufferSize)
+		return false;
+	strcpy(pchPathBuffer, path);
+	return true;
+}
+
+VR_INTERFACE const char *VR_CALLTYPE VR_GetVRInitErrorAsSymbol(EVRInitError error)
+{
+	return error == VRInitError_None ? "VRInitError_None" : "VRInitError_Unknown";
+}
+
+VR_INTERFACE const char *VR_CALLTYPE VR_GetVRInitErrorAsEnglishDescription(EVRInitError error)
+{
+	return error == VRInitError_None ? "No error" : "Mock runtime error, see the output above";
+}
@@ -0,0 +1,149 @@
+#include "allocs.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+
+const int REPORTED_FRAMES = 16;
+
+uint64_t Allocs::warmup_frames = 600;
+
+struct AllocCounts
+{
+	uint64_t calls;
+	uint64_t bytes;
+};
+
+// thread local, so driver and runtime threads allocating next to the frame loop are left out
+static thread_local bool in_frame = false;
+static thread_local int expected_depth = 0;
+static thread_local AllocCounts frame_counts;
+static thread_local AllocCounts expected_counts;
+
+static uint64_t frame = 0;
+static uint64_t failed_frames = 0;
+static AllocCounts total_counts;
+static AllocCounts total_expected;
+
+#ifdef SINPIN_ALLOC_COUNT
+static void Count(size_t bytes)
+{
+	if (!in_frame)
+	{
+		return;
+	}
+	auto counts = expected_depth > 0 ? &expected_counts : &frame_counts;
+	counts->calls++;
+	counts->bytes += bytes;
+}
+
+// glibc's own implementations, which stay reachable under these names when malloc is replaced
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+	Count(size);
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+	Count(count * size);
+	return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+	Count(size);
+	return __libc_realloc(ptr, size);
+}
+
+// the aligned variants all end up in glibc's memalign, whose blocks free() takes like any other
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+	Count(size);
+	return __libc_memalign(alignment, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+	Count(size);
+	return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+	if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+	{
+		return EINVAL;
+	}
+	Count(size);
+	void *block = __libc_memalign(alignment, size);
+	if (block == nullptr)
+	{
+		return ENOMEM;
+	}
+	*ptr = block;
+	return 0;
+}
+#endif
+
+void Allocs::FrameStart()
+{
+	frame_counts = AllocCounts{0, 0};
+	expected_counts = AllocCounts{0, 0};
+	in_frame = true;
+}
+
+void Allocs::FrameEnd()
+{
+	in_frame = false;
+	frame++;
+	if (frame <= warmup_frames)
+	{
+		return;
+	}
+	total_expected.calls += expected_counts.calls;
+	total_expected.bytes += expected_counts.bytes;
+	if (frame_counts.calls == 0)
+	{
+		return;
+	}
+	total_counts.calls += frame_counts.calls;
+	total_counts.bytes += frame_counts.bytes;
+	failed_frames++;
+	if (failed_frames <= REPORTED_FRAMES)
+	{
+		printf("frame %lu allocated %lu times (%lu bytes)\n", frame, frame_counts.calls, frame_counts.bytes);
+	}
+}
+
+void Allocs::BeginExpected()
+{
+	expected_depth++;
+}
+
+void Allocs::EndExpected()
+{
+	expected_depth--;
+}
+
+bool Allocs::Report()
+{
+	if (frame <= warmup_frames)
+	{
+		printf("allocations: only %lu frames ran, not past the %lu warmup frames\n", frame, warmup_frames);
+		return false;
+	}
+	uint64_t frames = frame - warmup_frames;
+	printf("allocations in %lu frames after warmup: %lu (%lu bytes) in %lu frames, libxcb replies %lu (%lu bytes)\n",
+		   frames,
+		   total_counts.calls,
+		   total_counts.bytes,
+		   failed_frames,
+		   total_expected.calls,
+		   total_expected.bytes);
+	return failed_frames == 0;
+}
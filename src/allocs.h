@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+
+// allocation counting for builds with SINPIN_ALLOC_COUNT (make alloccheck)
+// malloc, calloc, realloc and the aligned allocators (memalign, aligned_alloc, posix_memalign) are
+// replaced by versions that count what the main thread allocates inside App::Update, operator new
+// ends up in malloc so it is counted as well. valloc and pvalloc are obsolete and not counted.
+// Once warmed up, a frame is expected to allocate nothing, except for the replies and events libxcb
+// hands out, which can not be given a buffer to fill and are counted separately.
+namespace Allocs
+{
+extern uint64_t warmup_frames;
+
+void FrameStart();
+void FrameEnd();
+void BeginExpected();
+void EndExpected();
+// prints the allocations made after warmup, returns false if there were any
+bool Report();
+} // namespace Allocs
+
+class AllocFrameScope
+{
+  public:
+	AllocFrameScope()
+	{
+		Allocs::FrameStart();
+	}
+	~AllocFrameScope()
+	{
+		Allocs::FrameEnd();
+	}
+};
+
+class AllocExpectedScope
+{
+  public:
+	AllocExpectedScope()
+	{
+		Allocs::BeginExpected();
+	}
+	~AllocExpectedScope()
+	{
+		Allocs::EndExpected();
+	}
+};
+
+#ifdef SINPIN_ALLOC_COUNT
+#define ALLOC_FRAME() AllocFrameScope _alloc_frame_scope
+// a call that allocates on purpose, eg. `auto reply = ALLOC_EXPECTED(xcb_..._reply(...));`
+#define ALLOC_EXPECTED(call) ([&]() { AllocExpectedScope _alloc_expected_scope; return call; }())
+#define ALLOC_CHECK() Allocs::Report()
+#else
+#define ALLOC_FRAME()
+#define ALLOC_EXPECTED(call) (call)
+#define ALLOC_CHECK() true
+#endif
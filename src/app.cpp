@@ -1,49 +1,70 @@
 #include "app.h"
+#include "allocs.h"
 #include "controller.h"
+#include "probes.h"
+#include "profiler.h"
+#include "trace.h"
 #include "util.h"
+#include <X11/Xlib-xcb.h>
 #include <X11/Xlib.h>
 #include <X11/extensions/XTest.h>
-#include <X11/extensions/Xrandr.h>
 #include <cassert>
 #include <glm/matrix.hpp>
+#include <xcb/randr.h>
 
 const VRMat root_start_pose = {{{1, 0, 0, 0}, {0, 1, 0, 0.8f}, {0, 0, 1, 0}}}; // 0.8m above origin
 
-const int FRAME_INTERVAL = 4; // number of update loops until the frame buffer is updated
 const float TRANSPARENCY = 0.6f;
-
-App::App()
+// capture buffers beyond those the panels hold, for when uploads are pinned: a panel's last capture then
+// stays in use after its upload was issued, until the GPU has read it
+const int SPARE_CAPTURE_BUFFERS = 2;
+// fraction of the measured time until photons hit the eyes to predict controller poses for, 0 disables prediction
+const float POSE_PREDICTION = 1.0f;
+const int MAX_ENCODER_THREADS = 4;
+
+App::App(AppOptions options)
 {
+	_options = options;
 	_tracking_origin = vr::TrackingUniverseStanding;
 	_frames_since_framebuffer = 999;
 
 	InitOVR();
 	InitX11();
 	InitGLFW();
+	InitXFixes();
 	InitRootOverlay();
+	InitInputBackend();
 	printf("\n");
 	_controllers[0] = Controller(this, ControllerSide::Left);
 	_controllers[1] = Controller(this, ControllerSide::Right);
 
-	glGenTextures(1, &_gl_frame);
-	glBindTexture(GL_TEXTURE_2D, _gl_frame);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-	int monitor_count;
-	XRRMonitorInfo *monitor_info = XRRGetMonitors(_xdisplay, _root_window, 1, &monitor_count);
+	auto monitors_cookie = xcb_randr_get_monitors(_xcb, _root_window, 1);
+	auto monitors = xcb_randr_get_monitors_reply(_xcb, monitors_cookie, nullptr);
+	assert(monitors != nullptr);
+	int monitor_count = xcb_randr_get_monitors_monitors_length(monitors);
 	printf("found %d monitors:\n", monitor_count);
 
 	_pixels_per_meter = 1920;
 	_total_width_meters = _root_width / _pixels_per_meter;
 	_total_height_meters = _root_height / _pixels_per_meter;
 
-	for (int i = 0; i < monitor_count; i++)
+	// capture buffers all have the size of the largest monitor
+	size_t capture_size = 0;
+	int max_width = 0, max_height = 0;
+	auto monitor_iter = xcb_randr_get_monitors_monitors_iterator(monitors);
+	for (int i = 0; monitor_iter.rem; i++, xcb_randr_monitor_info_next(&monitor_iter))
 	{
-		XRRMonitorInfo mon = monitor_info[i];
-		printf("screen %d: pos(%d, %d) %dx%d\n", i, mon.x, mon.y, mon.width, mon.height);
+		auto mon = monitor_iter.data;
+		printf("screen %d: pos(%d, %d) %dx%d\n", i, mon->x, mon->y, mon->width, mon->height);
 
-		_panels.push_back(Panel(this, i, mon.x, mon.y, mon.width, mon.height));
+		_panels.push_back(Panel(this, i, mon->x, mon->y, mon->width, mon->height));
+		capture_size = std::max(capture_size, (size_t)mon->width * mon->height * 4);
+		max_width = std::max(max_width, (int)mon->width);
+		max_height = std::max(max_height, (int)mon->height);
 	}
+	free(monitors);
+	InitShm(capture_size);
+	InitCompression(max_width, max_height);
 
 	for (auto &panel : _panels)
 	{
@@ -91,6 +112,15 @@ App::App()
 
 App::~App()
 {
+	// the encoder may still read a capture buffer
+	_bc1_encoder.Stop();
+	// GL objects go before glfwTerminate destroys their context
+	for (auto &panel : _panels)
+	{
+		panel.Destroy();
+	}
+	_latency_probe.Stop();
+	_capture_pool.Destroy();
 	vr::VR_Shutdown();
 	glfwDestroyWindow(_gl_window);
 	glfwTerminate();
@@ -102,11 +132,136 @@ void App::InitX11()
 	_xdisplay = XOpenDisplay(nullptr);
 	assert(_xdisplay != nullptr);
 	printf("Created X11 display\n");
+	// Xlib is only used for input injection, everything that waits for a reply goes through xcb
+	_xcb = XGetXCBConnection(_xdisplay);
+	XSetEventQueueOwner(_xdisplay, XCBOwnsEventQueue);
 	_root_window = XRootWindow(_xdisplay, 0);
-	XWindowAttributes attributes;
-	XGetWindowAttributes(_xdisplay, _root_window, &attributes);
-	_root_width = attributes.width;
-	_root_height = attributes.height;
+	auto geometry = xcb_get_geometry_reply(_xcb, xcb_get_geometry(_xcb, _root_window), nullptr);
+	assert(geometry != nullptr);
+	_root_width = geometry->width;
+	_root_height = geometry->height;
+	free(geometry);
+	InitPixelFormat();
+}
+
+void App::InitPixelFormat()
+{
+	auto setup = xcb_get_setup(_xcb);
+	auto screen = xcb_setup_roots_iterator(setup).data;
+	xcb_visualtype_t *visual = nullptr;
+	for (auto depth_iter = xcb_screen_allowed_depths_iterator(screen); depth_iter.rem && visual == nullptr; xcb_depth_next(&depth_iter))
+	{
+		for (auto visual_iter = xcb_depth_visuals_iterator(depth_iter.data); visual_iter.rem; xcb_visualtype_next(&visual_iter))
+		{
+			if (visual_iter.data->visual_id == screen->root_visual)
+			{
+				visual = visual_iter.data;
+				break;
+			}
+		}
+	}
+	assert(visual != nullptr);
+	int bits_per_pixel = 0;
+	_scanline_pad = 32;
+	for (auto format_iter = xcb_setup_pixmap_formats_iterator(setup); format_iter.rem; xcb_format_next(&format_iter))
+	{
+		if (format_iter.data->depth == screen->root_depth)
+		{
+			bits_per_pixel = format_iter.data->bits_per_pixel;
+			_scanline_pad = format_iter.data->scanline_pad;
+		}
+	}
+	bool lsb_first = setup->image_byte_order == XCB_IMAGE_ORDER_LSB_FIRST;
+	_pixel_format = FindPixelFormat(bits_per_pixel, lsb_first, visual->red_mask, visual->green_mask, visual->blue_mask);
+	if (_pixel_format == PixelFormat::Unsupported)
+	{
+		printf("Unsupported root window format: depth %d, %d bits per pixel, masks %x %x %x, %s first\n",
+			   screen->root_depth, bits_per_pixel, visual->red_mask, visual->green_mask, visual->blue_mask,
+			   lsb_first ? "LSB" : "MSB");
+		exit(1);
+	}
+	if (_pixel_format != PixelFormat::BGRX)
+	{
+		printf("Converting %s captures to BGRX with %s kernels\n", PixelFormatName(_pixel_format), PixelKernelName(PixelKernelCount() - 1));
+	}
+}
+
+void App::InitShm(size_t buffer_size)
+{
+	if (_options.capture != CaptureBackend::Shm)
+	{
+		printf("Capturing through regular GetImage requests\n");
+		return;
+	}
+	// converted captures are uploaded from a copy, so their buffer is free again right after the reply
+	bool uploads_from_pool = _pixel_format == PixelFormat::BGRX;
+	// with an upload budget, a panel can still be uploading one capture while the next one comes in
+	int buffers_per_panel = uploads_from_pool && _options.upload_budget > 0 ? 2 : 1;
+	bool pinned = uploads_from_pool && _options.upload == UploadBackend::Pinned && glfwExtensionSupported("GL_AMD_pinned_memory");
+	int buffer_count = _panels.size() * buffers_per_panel + (pinned ? SPARE_CAPTURE_BUFFERS : 0);
+	if (_capture_pool.Init(_xcb, buffer_size, buffer_count, _options.lock_capture_memory) && pinned)
+	{
+		_capture_pool.Pin();
+	}
+}
+
+void App::InitCompression(int max_width, int max_height)
+{
+	if (_options.compress_idle_seconds <= 0)
+	{
+		return;
+	}
+	if (!_options.tile_uploads || !glfwExtensionSupported("GL_EXT_texture_compression_s3tc"))
+	{
+		printf("BC1 compression of idle panels needs tile uploads and GL_EXT_texture_compression_s3tc\n");
+		return;
+	}
+	int threads = std::clamp((int)std::thread::hardware_concurrency() / 2, 1, MAX_ENCODER_THREADS);
+	_bc1_encoder.Init(threads, max_width, max_height);
+	printf("Panels idle for %.1f s are shown as BC1, encoded on %d threads\n", _options.compress_idle_seconds, threads);
+}
+
+void App::InitXFixes()
+{
+	_gl_cursor = 0;
+	_cursor_image = CursorImage{0, 0, 0, 0, 0};
+	auto version = xcb_xfixes_query_version_reply(_xcb, xcb_xfixes_query_version(_xcb, 4, 0), nullptr);
+	if (version == nullptr)
+	{
+		printf("XFixes not available, falling back to SteamVR cursor\n");
+		return;
+	}
+	free(version);
+	_xfixes_event_base = xcb_get_extension_data(_xcb, &xcb_xfixes_id)->first_event;
+	xcb_xfixes_select_cursor_input(_xcb, _root_window, XCB_XFIXES_CURSOR_NOTIFY_MASK_DISPLAY_CURSOR);
+
+	glGenTextures(1, &_gl_cursor);
+	glBindTexture(GL_TEXTURE_2D, _gl_cursor);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// no notify event arrives until the shape changes, so fetch the initial one right away
+	_cursor_image_cookie = xcb_xfixes_get_cursor_image(_xcb);
+	_cursor_image_pending = true;
+	UpdateCursorImage();
+}
+
+void App::InitInputBackend()
+{
+	_input_backend = InputBackend::XTest;
+	if (_options.input != InputBackend::UInput)
+	{
+		printf("Injecting input through XTest\n");
+		return;
+	}
+	if (_pointer_device.CreateAbsolutePointer(_root_width, _root_height))
+		_input_backend = InputBackend::UInput;
+	else
+		printf("uinput not available, injecting pointer input through XTest\n");
+	if (!_scroll_device.CreateScrollWheel())
+	{
+		printf("Smooth scrolling not available, scrolling with mouse buttons\n");
+	}
 }
 
 void App::InitOVR()
@@ -127,6 +282,10 @@ void App::InitOVR()
 	printf("Initialized OpenVR\n");
 	vr_overlay = vr::VROverlay();
 	vr_input = vr::VRInput();
+
+	float display_frequency = vr_sys->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float);
+	_frame_duration = display_frequency > 0 ? 1.0f / display_frequency : 0;
+	_vsync_to_photons = vr_sys->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float);
 }
 
 void App::InitGLFW()
@@ -137,6 +296,7 @@ void App::InitGLFW()
 	_gl_window = glfwCreateWindow(1, 1, "Overlay", nullptr, nullptr);
 	assert(_gl_window != nullptr);
 	glfwMakeContextCurrent(_gl_window);
+	_copy_image_supported = glfwExtensionSupported("GL_ARB_copy_image");
 	printf("Created GLFW context\n");
 }
 
@@ -152,21 +312,42 @@ void App::InitRootOverlay()
 
 void App::Update(float dtime)
 {
+	PROFILE_FRAME();
+	ALLOC_FRAME();
+	Trace::frame++;
+	PROBE1(frame_start, Trace::frame);
+	TRACE_SCOPE("App::Update");
+	// capture requests are only issued here, the X server answers them while we process input
+	UpdateFramebuffer();
+	RequestCursorImage();
 	UpdateInput(dtime);
+	// everything the controllers injected this frame goes out in one write
+	_pointer_device.Flush();
 	if (!_hidden)
 	{
+		RequestCursorPosition();
+		UpdateCursorImage();
 		_root_overlay.Update();
-		UpdateFramebuffer();
+		_upload_budget = _options.upload_budget > 0 ? _options.upload_budget : SIZE_MAX;
 		for (auto &panel : _panels)
 		{
 			panel.Update();
 		}
+		UploadPanels();
+	}
+	if (_latency_probe.IsEnabled())
+	{
+		_latency_probe.Paint();
 	}
 	_frames_since_framebuffer += 1;
+	PROFILE_TICK();
+	PROBE1(frame_end, Trace::frame);
 }
 
 void App::UpdateInput(float dtime)
 {
+	PROFILE_STAGE(Stage::Input);
+	TRACE_SCOPE("App::UpdateInput");
 	vr::VRActiveActionSet_t active_sets[2];
 	active_sets[0].ulActionSet = _input_handles.main_set;
 	active_sets[0].ulRestrictedToDevice = 0;
@@ -181,11 +362,22 @@ void App::UpdateInput(float dtime)
 		if (_edit_mode)
 			active_sets[1].ulActionSet = _input_handles.edit_set;
 	}
-	vr::EVRInputError err = vr_input->UpdateActionState(active_sets, sizeof(vr::VRActiveActionSet_t), set_count);
+	vr::EVRInputError err = TRACE_CALL("IVRInput::UpdateActionState", vr_input->UpdateActionState(active_sets, sizeof(vr::VRActiveActionSet_t), set_count));
 	if (err)
 		printf("Error updating action state: %d\n", err);
 
-	vr_sys->GetDeviceToAbsoluteTrackingPose(_tracking_origin, 0, _tracker_poses, MAX_TRACKERS);
+	if (_input_log.IsReplaying())
+	{
+		if (!_input_log.ReplayFrame(&dtime))
+			return;
+	}
+	else
+	{
+		float predicted_seconds = PredictedSecondsToPhotons();
+		TRACE_CALL("IVRSystem::GetDeviceToAbsoluteTrackingPose", vr_sys->GetDeviceToAbsoluteTrackingPose(_tracking_origin, predicted_seconds, _tracker_poses, MAX_TRACKERS));
+		if (_input_log.IsRecording())
+			_input_log.RecordFrame(dtime);
+	}
 
 	if (IsInputJustPressed(_input_handles.main.toggle_hidden))
 	{
@@ -236,37 +428,65 @@ void App::UpdateInput(float dtime)
 	_controllers[1]->Update(dtime);
 }
 
+float App::PredictedSecondsToPhotons()
+{
+	if (POSE_PREDICTION == 0)
+	{
+		return 0;
+	}
+	// same estimate the OpenVR docs recommend: the rest of this frame, plus the display latency
+	float since_vsync;
+	uint64_t frame_counter;
+	if (!TRACE_CALL("IVRSystem::GetTimeSinceLastVsync", vr_sys->GetTimeSinceLastVsync(&since_vsync, &frame_counter)))
+	{
+		return 0;
+	}
+	float to_photons = _frame_duration - since_vsync + _vsync_to_photons;
+	return glm::max(to_photons, 0.0f) * POSE_PREDICTION;
+}
+
 void App::UpdateUIVisibility()
 {
 	bool state = _hidden || !_edit_mode;
 	_root_overlay.SetHidden(state);
 }
 
+void App::UploadPanels()
+{
+	for (auto &panel : _panels)
+	{
+		panel.UpdateFocus();
+	}
+	// the panels being pointed at or looked at get the upload budget first
+	for (auto rank : {UploadFocus::Laser, UploadFocus::View, UploadFocus::Anywhere})
+	{
+		for (auto &panel : _panels)
+		{
+			if (panel.FocusRank() == rank)
+				panel.UploadPending();
+		}
+	}
+}
+
 void App::UpdateFramebuffer()
 {
-	if (_frames_since_framebuffer < FRAME_INTERVAL)
+	PROFILE_STAGE(Stage::Framebuffer);
+	TRACE_SCOPE("App::UpdateFramebuffer");
+	if (_hidden || _frames_since_framebuffer < _options.frame_interval)
 	{
 		return;
 	}
 	_frames_since_framebuffer = 0;
-	auto frame = XGetImage(
-		_xdisplay,
-		_root_window,
-		0, 0,
-		_root_width, _root_height,
-		AllPlanes,
-		ZPixmap);
-	glBindTexture(GL_TEXTURE_2D, _gl_frame);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, _root_width, _root_height, 0, GL_BGRA, GL_UNSIGNED_BYTE, frame->data);
-	XDestroyImage(frame);
+	for (auto &panel : _panels)
+	{
+		panel.RequestCapture();
+	}
+	TRACE_CALL("xcb_flush", xcb_flush(_xcb));
 }
 
-std::vector<TrackerID> App::GetControllers()
+int App::GetControllers(TrackerID *controllers, int max_count)
 {
-	static const auto max_len = 64;
-	TrackerID controllers[max_len];
-	int controller_count = vr_sys->GetSortedTrackedDeviceIndicesOfClass(vr::TrackedDeviceClass_Controller, controllers, max_len);
-	return std::vector<TrackerID>(controllers, controllers + controller_count);
+	return vr_sys->GetSortedTrackedDeviceIndicesOfClass(vr::TrackedDeviceClass_Controller, controllers, max_count);
 }
 
 glm::mat4 App::GetTrackerPose(TrackerID tracker)
@@ -276,14 +496,20 @@ glm::mat4 App::GetTrackerPose(TrackerID tracker)
 
 vr::InputDigitalActionData_t App::GetInputDigital(vr::VRActionHandle_t action, vr::VRInputValueHandle_t controller)
 {
+	if (_input_log.IsReplaying())
+		return _input_log.GetDigital(action, controller);
 	vr::InputDigitalActionData_t state;
+	TRACE_SCOPE("IVRInput::GetDigitalActionData");
 	vr_input->GetDigitalActionData(action, &state, sizeof(vr::InputDigitalActionData_t), controller);
 	return state;
 }
 
 vr::InputAnalogActionData_t App::GetInputAnalog(vr::VRActionHandle_t action, vr::VRInputValueHandle_t controller)
 {
+	if (_input_log.IsReplaying())
+		return _input_log.GetAnalog(action, controller);
 	vr::InputAnalogActionData_t state;
+	TRACE_SCOPE("IVRInput::GetAnalogActionData");
 	vr_input->GetAnalogActionData(action, &state, sizeof(vr::InputAnalogActionData_t), controller);
 	return state;
 }
@@ -296,6 +522,7 @@ bool App::IsInputJustPressed(vr::VRActionHandle_t action, vr::VRInputValueHandle
 
 Ray App::IntersectRay(glm::vec3 origin, glm::vec3 direction, float max_len)
 {
+	PROFILE_STAGE(Stage::Picking);
 	Ray ray;
 	ray.distance = max_len;
 	ray.overlay = nullptr;
@@ -317,31 +544,154 @@ Ray App::IntersectRay(glm::vec3 origin, glm::vec3 direction, float max_len)
 	return ray;
 }
 
+void App::RequestCursorImage()
+{
+	if (_gl_cursor == 0)
+	{
+		return;
+	}
+	bool changed = false;
+	xcb_generic_event_t *event;
+	TRACE_SCOPE("xcb_poll_for_event");
+	while ((event = ALLOC_EXPECTED(xcb_poll_for_event(_xcb))) != nullptr)
+	{
+		if ((event->response_type & ~0x80) == _xfixes_event_base + XCB_XFIXES_CURSOR_NOTIFY)
+		{
+			changed = true;
+		}
+		free(event);
+	}
+	if (changed)
+	{
+		if (_cursor_image_pending)
+		{
+			xcb_discard_reply(_xcb, _cursor_image_cookie.sequence);
+		}
+		_cursor_image_cookie = TRACE_CALL("xcb_xfixes_get_cursor_image", xcb_xfixes_get_cursor_image(_xcb));
+		_cursor_image_pending = true;
+	}
+}
+
+void App::UpdateCursorImage()
+{
+	if (!_cursor_image_pending)
+	{
+		return;
+	}
+	_cursor_image_pending = false;
+	TRACE_SCOPE("App::UpdateCursorImage");
+	auto reply = TRACE_CALL("xcb_xfixes_get_cursor_image_reply", ALLOC_EXPECTED(xcb_xfixes_get_cursor_image_reply(_xcb, _cursor_image_cookie, nullptr)));
+	if (reply == nullptr)
+	{
+		return;
+	}
+	// XFixes hands out premultiplied ARGB words, which are BGRA bytes on little endian
+	glBindTexture(GL_TEXTURE_2D, _gl_cursor);
+	glTexImage2D(
+		GL_TEXTURE_2D, 0, GL_RGBA,
+		reply->width, reply->height, 0,
+		GL_BGRA, GL_UNSIGNED_BYTE, xcb_xfixes_get_cursor_image_cursor_image(reply));
+	_cursor_image.width = reply->width;
+	_cursor_image.height = reply->height;
+	_cursor_image.hot_x = reply->xhot;
+	_cursor_image.hot_y = reply->yhot;
+	_cursor_image.serial++;
+	free(reply);
+}
+
+void App::RequestCursorPosition()
+{
+	if (_cursor_pending)
+	{
+		xcb_discard_reply(_xcb, _cursor_cookie.sequence);
+	}
+	_cursor_cookie = TRACE_CALL("xcb_query_pointer", xcb_query_pointer(_xcb, _root_window));
+	_cursor_pending = true;
+}
+
 CursorPos App::GetCursorPosition()
 {
-	Window curr_root;
-	Window curr_win;
-	CursorPos pos;
-	CursorPos pos_local;
-	unsigned int buttons;
-	XQueryPointer(
-		_xdisplay,
-		_root_window,
-		&curr_root,
-		&curr_win,
-		&pos.x, &pos.y,
-		&pos_local.x, &pos_local.y,
-		&buttons);
-	return pos;
+	// the reply is fetched once per request, all panels share the result
+	if (_cursor_pending)
+	{
+		_cursor_pending = false;
+		auto reply = TRACE_CALL("xcb_query_pointer_reply", ALLOC_EXPECTED(xcb_query_pointer_reply(_xcb, _cursor_cookie, nullptr)));
+		if (reply != nullptr)
+		{
+			_cursor_pos = CursorPos{reply->root_x, reply->root_y};
+			free(reply);
+		}
+	}
+	return _cursor_pos;
 }
 
 void App::SetCursor(int x, int y)
 {
+	PROBE2(pointer_warp, x, y);
+	if (_input_backend == InputBackend::UInput)
+	{
+		_pointer_device.Emit(EV_ABS, ABS_X, x);
+		_pointer_device.Emit(EV_ABS, ABS_Y, y);
+		return;
+	}
+	TRACE_SCOPE("XWarpPointer");
 	// I don't know what the return value of XWarpPointer means, it seems to be 1 on success.
 	XWarpPointer(_xdisplay, _root_window, _root_window, 0, 0, _root_width, _root_height, x, y);
 }
 
 void App::SendMouseInput(unsigned int button, bool state)
 {
-	XTestFakeButtonEvent(_xdisplay, button, state, 0);
+	PROBE2(button_inject, button, state);
+	if (_input_backend == InputBackend::UInput)
+	{
+		static const uint16_t button_codes[] = {BTN_LEFT, BTN_MIDDLE, BTN_RIGHT};
+		if (button >= 1 && button <= 3)
+		{
+			// a separate frame per button change, so a press and release in the same update both register
+			_pointer_device.Sync();
+			_pointer_device.Emit(EV_KEY, button_codes[button - 1], state);
+			_pointer_device.Sync();
+			return;
+		}
+	}
+	TRACE_CALL("XTestFakeButtonEvent", XTestFakeButtonEvent(_xdisplay, button, state, 0));
+}
+
+// positive scrolls up, returns how many whole notches were crossed
+int App::SendScroll(float notches)
+{
+	if (_scroll_device.IsOpen())
+	{
+		// high resolution wheel events are in 1/120ths of a notch
+		_scroll_remainder += notches * 120;
+		int hi_res = (int)_scroll_remainder;
+		if (hi_res == 0)
+		{
+			return 0;
+		}
+		_scroll_remainder -= hi_res;
+		_scroll_device.Emit(EV_REL, REL_WHEEL_HI_RES, hi_res);
+
+		// plain wheel events are still expected by clients that ignore the high resolution axis
+		_scroll_notch_remainder += hi_res;
+		int whole = _scroll_notch_remainder / 120;
+		if (whole != 0)
+		{
+			_scroll_notch_remainder -= whole * 120;
+			_scroll_device.Emit(EV_REL, REL_WHEEL, whole);
+		}
+		_scroll_device.Flush();
+		return whole;
+	}
+
+	_scroll_remainder += notches;
+	int whole = (int)_scroll_remainder;
+	_scroll_remainder -= whole;
+	unsigned int button = whole > 0 ? 4 : 5;
+	for (int i = 0; i < glm::abs(whole); i++)
+	{
+		SendMouseInput(button, true);
+		SendMouseInput(button, false);
+	}
+	return whole;
 }
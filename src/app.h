@@ -1,19 +1,65 @@
 #pragma once
 #define GL_GLEXT_PROTOTYPES
 
+#include "bc1.h"
+#include "capturepool.h"
 #include "controller.h"
+#include "inputlog.h"
+#include "latency.h"
 #include "overlay.h"
 #include "panel.h"
+#include "pixelformat.h"
+#include "uinput.h"
 #include "util.h"
 #include <GLFW/glfw3.h>
 #include <X11/Xutil.h>
 #include <filesystem>
 #include <optional>
 #include <vector>
+#include <xcb/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/xfixes.h>
 
-struct CursorPos
+enum class InputBackend
 {
-	int x, y;
+	XTest,
+	UInput,
+};
+
+enum class CaptureBackend
+{
+	GetImage,
+	Shm, // falls back to GetImage if MIT-SHM is unavailable
+};
+
+enum class UploadBackend
+{
+	Copy,   // glTexSubImage2D from client memory, which the driver copies before uploading
+	Pinned, // from the MIT-SHM segment pinned with AMD_pinned_memory, falls back to Copy
+};
+
+struct AppOptions
+{
+	CaptureBackend capture = CaptureBackend::Shm;
+	UploadBackend upload = UploadBackend::Pinned;
+	// uinput devices only reach an X server that reads the kernel's input devices, so not Xvfb, nested or
+	// remote ones, those need XTest. Falls back to XTest if the devices can not be created
+	InputBackend input = InputBackend::UInput;
+	int frame_interval = 4; // number of update loops until the frame buffer is updated
+	bool tile_uploads = true; // only upload the tiles that changed since the last capture
+	bool scroll_detection = true; // move scrolled content on the GPU, needs tile_uploads
+	bool lock_capture_memory = false; // mlock the capture buffers so they are never paged out
+	// bytes uploaded per update at most, the rest of a capture follows in later updates, 0 for no limit
+	size_t upload_budget = 16 * 1024 * 1024;
+	int upload_deadline_ms = 100; // tiles pending for this long are uploaded regardless of the budget
+	float compress_idle_seconds = 0; // panels unchanged for this long are shown as BC1, 0 disables
+};
+
+struct CursorImage
+{
+	int width, height;
+	int hot_x, hot_y;
+	int serial; // incremented every time a new image is uploaded
 };
 
 struct InputHandles
@@ -47,27 +93,44 @@ struct InputHandles
 class App
 {
   public:
-	App();
+	App(AppOptions options);
 	~App();
 	void Update(float dtime);
 
-	std::vector<TrackerID> GetControllers();
+	// fills controllers with up to max_count device indices, returns how many there are
+	int GetControllers(TrackerID *controllers, int max_count);
 	glm::mat4 GetTrackerPose(TrackerID tracker);
 	vr::InputDigitalActionData_t GetInputDigital(vr::VRActionHandle_t action, vr::VRInputValueHandle_t controller = 0);
 	vr::InputAnalogActionData_t GetInputAnalog(vr::VRActionHandle_t action, vr::VRInputValueHandle_t controller = 0);
 	bool IsInputJustPressed(vr::VRActionHandle_t action, vr::VRInputValueHandle_t controller = 0);
+	void RequestCursorPosition();
 	CursorPos GetCursorPosition();
 
 	Ray IntersectRay(glm::vec3 origin, glm::vec3 direction, float max_len);
 	void SetCursor(int x, int y);
 	void SendMouseInput(unsigned int button, bool state);
+	int SendScroll(float notches);
 
 	Display *_xdisplay;
+	xcb_connection_t *_xcb;
 	Window _root_window;
+	// of the root window's ZPixmap captures, anything but BGRX is converted before hashing and uploading
+	PixelFormat _pixel_format;
+	int _scanline_pad; // bits every captured row is padded to
 	GLFWwindow *_gl_window;
-	GLuint _gl_frame;
+	bool _copy_image_supported; // glCopyImageSubData, for moving scrolled content within a texture
 	int _frames_since_framebuffer;
 
+	// buffers the panels capture into, not ready if MIT-SHM is unavailable
+	CapturePool _capture_pool;
+	size_t _upload_budget; // left in this update, panels subtract what they upload
+	// shared by the panels that went idle, not ready if compression is disabled or unsupported
+	Bc1Encoder _bc1_encoder;
+
+	// texture of the current cursor shape, 0 if XFixes is unavailable
+	GLuint _gl_cursor;
+	CursorImage _cursor_image;
+
 	int _root_width;
 	int _root_height;
 	float _pixels_per_meter;
@@ -75,6 +138,8 @@ class App
 	float _total_width_meters;
 
 	vr::ETrackingUniverseOrigin _tracking_origin;
+	float _frame_duration;
+	float _vsync_to_photons;
 	std::filesystem::path _actions_path;
 
 	vr::IVRSystem *vr_sys;
@@ -85,6 +150,9 @@ class App
 	vr::TrackedDevicePose_t _tracker_poses[MAX_TRACKERS];
 	std::optional<Controller> _controllers[2];
 
+	AppOptions _options;
+	InputLog _input_log;
+	LatencyProbe _latency_probe;
 	Overlay _root_overlay;
 	std::vector<Panel> _panels;
 	bool _hidden = false;
@@ -94,11 +162,34 @@ class App
 
   private:
 	void InitX11();
+	void InitPixelFormat();
+	void InitShm(size_t buffer_size);
+	void InitCompression(int max_width, int max_height);
+	void InitXFixes();
+	void InitInputBackend();
 	void InitOVR();
 	void InitGLFW();
 	void InitRootOverlay();
 
 	void UpdateFramebuffer();
+	void UploadPanels();
+	void RequestCursorImage();
+	void UpdateCursorImage();
 	void UpdateInput(float dtime);
 	void UpdateUIVisibility();
+	float PredictedSecondsToPhotons();
+
+	xcb_query_pointer_cookie_t _cursor_cookie;
+	bool _cursor_pending = false;
+	CursorPos _cursor_pos = {0, 0};
+
+	InputBackend _input_backend;
+	UInputDevice _pointer_device;
+	UInputDevice _scroll_device;
+	float _scroll_remainder = 0; // in 1/120ths of a notch when using the scroll device, in notches otherwise
+	int _scroll_notch_remainder = 0;
+
+	uint8_t _xfixes_event_base;
+	xcb_xfixes_get_cursor_image_cookie_t _cursor_image_cookie;
+	bool _cursor_image_pending = false;
 };
\ No newline at end of file
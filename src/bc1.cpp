@@ -0,0 +1,283 @@
+#include "bc1.h"
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// palette index for a pixel by its position between color1 (0) and color0 (3)
+const uint32_t INDEX_FOR_POSITION[4] = {1, 3, 2, 0};
+
+static uint16_t To565(const int color[3])
+{
+	return (color[2] >> 3) << 11 | (color[1] >> 2) << 5 | color[0] >> 3;
+}
+
+// the 8 bit color a 565 color decodes to, in BGR order
+static void From565(uint16_t c, int color[3])
+{
+	int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+	color[0] = b << 3 | b >> 2;
+	color[1] = g << 2 | g >> 4;
+	color[2] = r << 3 | r >> 2;
+}
+
+#ifdef __SSE2__
+static void BlockBounds(const uint8_t block[64], uint8_t min[4], uint8_t max[4])
+{
+	__m128i row0 = _mm_loadu_si128((const __m128i *)block);
+	__m128i row1 = _mm_loadu_si128((const __m128i *)(block + 16));
+	__m128i row2 = _mm_loadu_si128((const __m128i *)(block + 32));
+	__m128i row3 = _mm_loadu_si128((const __m128i *)(block + 48));
+	__m128i low = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+	__m128i high = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+	// down from 4 pixels to 1
+	low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+	low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+	high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+	high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+	uint32_t low_pixel = _mm_cvtsi128_si32(low);
+	uint32_t high_pixel = _mm_cvtsi128_si32(high);
+	memcpy(min, &low_pixel, 4);
+	memcpy(max, &high_pixel, 4);
+}
+#else
+static void BlockBounds(const uint8_t block[64], uint8_t min[4], uint8_t max[4])
+{
+	memcpy(min, block, 4);
+	memcpy(max, block, 4);
+	for (int i = 4; i < 64; i++)
+	{
+		min[i % 4] = std::min(min[i % 4], block[i]);
+		max[i % 4] = std::max(max[i % 4], block[i]);
+	}
+}
+#endif
+
+// finds the colors of a block that has at most two, like text on a plain background
+static bool TwoColors(const uint8_t block[64], int first[3], int second[3])
+{
+	const uint32_t RGB = 0xffffff;
+	uint32_t pixels[16];
+	memcpy(pixels, block, 64);
+	uint32_t a = pixels[0] & RGB, b = a;
+	for (int i = 1; i < 16; i++)
+	{
+		if ((pixels[i] & RGB) != a)
+		{
+			b = pixels[i] & RGB;
+			break;
+		}
+	}
+	// without branches, so the compiler can vectorize it
+	int others = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		uint32_t pixel = pixels[i] & RGB;
+		others += pixel != a && pixel != b;
+	}
+	if (others > 0)
+	{
+		return false;
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		first[c] = (a >> (c * 8)) & 0xff;
+		second[c] = (b >> (c * 8)) & 0xff;
+	}
+	return true;
+}
+
+// endpoints from the bounding box of the block's colors, in the style of van Waveren's real-time DXT
+// compression: the box is inset a little, and its diagonal follows the sign of the covariances
+// Blocks of one or two colors use them as they are, the inset would pull both towards grey.
+static void EncodeBlock(const uint8_t block[64], uint8_t *out)
+{
+	int high[3], low[3];
+	if (!TwoColors(block, high, low))
+	{
+		uint8_t min[4], max[4];
+		BlockBounds(block, min, max);
+		for (int c = 0; c < 3; c++)
+		{
+			int inset = (max[c] - min[c]) >> 4;
+			high[c] = max[c] - inset;
+			low[c] = min[c] + inset;
+		}
+		int cov_bg = 0, cov_br = 0, cov_gr = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			const uint8_t *p = block + i * 4;
+			int b = p[0] * 2 - max[0] - min[0];
+			int g = p[1] * 2 - max[1] - min[1];
+			int r = p[2] * 2 - max[2] - min[2];
+			cov_bg += b * g;
+			cov_br += b * r;
+			cov_gr += g * r;
+		}
+		// the channel that varies most keeps its direction, the others follow the sign of their covariance with it
+		int range[3] = {max[0] - min[0], max[1] - min[1], max[2] - min[2]};
+		int reference = 1;
+		if (range[0] > range[reference])
+			reference = 0;
+		if (range[2] > range[reference])
+			reference = 2;
+		const int cov_with[3][3] = {{0, cov_bg, cov_br}, {cov_bg, 0, cov_gr}, {cov_br, cov_gr, 0}};
+		for (int c = 0; c < 3; c++)
+		{
+			if (cov_with[reference][c] < 0)
+				std::swap(high[c], low[c]);
+		}
+	}
+
+	uint16_t color0 = To565(high);
+	uint16_t color1 = To565(low);
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int e0[3], e1[3];
+		From565(color0, e0);
+		From565(color1, e1);
+		int dir[3] = {e0[0] - e1[0], e0[1] - e1[1], e0[2] - e1[2]};
+		int length = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+		for (int i = 0; i < 16; i++)
+		{
+			const uint8_t *p = block + i * 4;
+			int t = (p[0] - e1[0]) * dir[0] + (p[1] - e1[1]) * dir[1] + (p[2] - e1[2]) * dir[2];
+			t = std::clamp(t, 0, length);
+			int position = (t * 6 + length) / (length * 2);
+			indices |= INDEX_FOR_POSITION[position] << (i * 2);
+		}
+		if (color0 < color1)
+		{
+			// color0 > color1 selects the 4 color mode, swapping the endpoints swaps indices 0/1 and 2/3
+			std::swap(color0, color1);
+			indices ^= 0x55555555;
+		}
+	}
+	memcpy(out, &color0, 2);
+	memcpy(out + 2, &color1, 2);
+	memcpy(out + 4, &indices, 4);
+}
+
+void EncodeBc1Row(const uint8_t *pixels, int width, int height, int block_row, uint8_t *out)
+{
+	int blocks = (width + 3) / 4;
+	int y0 = block_row * BC1_BLOCK_SIZE;
+	size_t stride = (size_t)width * 4;
+	alignas(16) uint8_t block[64];
+	for (int bx = 0; bx < blocks; bx++)
+	{
+		int x0 = bx * BC1_BLOCK_SIZE;
+		for (int y = 0; y < BC1_BLOCK_SIZE; y++)
+		{
+			const uint8_t *row = pixels + std::min(y0 + y, height - 1) * stride;
+			if (x0 + BC1_BLOCK_SIZE <= width)
+			{
+				memcpy(block + y * 16, row + x0 * 4, 16);
+				continue;
+			}
+			for (int x = 0; x < BC1_BLOCK_SIZE; x++)
+				memcpy(block + y * 16 + x * 4, row + std::min(x0 + x, width - 1) * 4, 4);
+		}
+		EncodeBlock(block, out + bx * BC1_BLOCK_BYTES);
+	}
+}
+
+Bc1Encoder::~Bc1Encoder()
+{
+	Stop();
+}
+
+void Bc1Encoder::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_wake.notify_all();
+	for (auto &thread : _threads)
+	{
+		thread.join();
+	}
+	_threads.clear();
+}
+
+void Bc1Encoder::Init(int thread_count, int max_width, int max_height)
+{
+	_blocks.resize(Bc1Size(max_width, max_height));
+	for (int i = 0; i < thread_count; i++)
+	{
+		_threads.emplace_back(&Bc1Encoder::Work, this);
+	}
+}
+
+bool Bc1Encoder::IsReady()
+{
+	return !_threads.empty();
+}
+
+bool Bc1Encoder::Start(const uint8_t *pixels, int width, int height)
+{
+	if (_busy || _threads.empty() || Bc1Size(width, height) > _blocks.size())
+	{
+		return false;
+	}
+	_busy = true;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pixels = pixels;
+		_width = width;
+		_height = height;
+		_block_rows = (height + 3) / 4;
+		_next_row.store(0, std::memory_order_relaxed);
+		_working.store(_threads.size(), std::memory_order_relaxed);
+		_job++;
+	}
+	_wake.notify_all();
+	return true;
+}
+
+bool Bc1Encoder::IsDone()
+{
+	return _busy && _working.load(std::memory_order_acquire) == 0;
+}
+
+const uint8_t *Bc1Encoder::Data()
+{
+	return _blocks.data();
+}
+
+size_t Bc1Encoder::Size()
+{
+	return Bc1Size(_width, _height);
+}
+
+void Bc1Encoder::Release()
+{
+	_busy = false;
+}
+
+void Bc1Encoder::Work()
+{
+	uint64_t last_job = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [&] { return _quit || _job != last_job; });
+			if (_quit)
+				return;
+			last_job = _job;
+		}
+		size_t row_bytes = (size_t)((_width + 3) / 4) * BC1_BLOCK_BYTES;
+		int row;
+		while ((row = _next_row.fetch_add(1, std::memory_order_relaxed)) < _block_rows)
+		{
+			EncodeBc1Row(_pixels, _width, _height, row, _blocks.data() + row * row_bytes);
+		}
+		// the image is done once every worker ran out of rows, so none of them still reads the old one
+		// when the next starts
+		_working.fetch_sub(1, std::memory_order_release);
+	}
+}
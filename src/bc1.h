@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// GL_EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+const int BC1_BLOCK_SIZE = 4;  // pixels along each side
+const int BC1_BLOCK_BYTES = 8; // two RGB565 endpoints and 16 2 bit indices
+
+inline size_t Bc1Size(int width, int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BC1_BLOCK_BYTES;
+}
+
+// one row of 4x4 blocks from BGRX pixels, edge blocks repeat the last column and row
+void EncodeBc1Row(const uint8_t *pixels, int width, int height, int block_row, uint8_t *out);
+
+// Encodes captures to BC1 on worker threads, one image at a time. Every thread takes rows of blocks
+// until none are left, so the image is done in roughly 1/threads of the time of a single one.
+// The output buffer is allocated once, for the largest image it will be given.
+class Bc1Encoder
+{
+  public:
+	Bc1Encoder() = default;
+	Bc1Encoder(const Bc1Encoder &) = delete;
+	Bc1Encoder &operator=(const Bc1Encoder &) = delete;
+	~Bc1Encoder();
+
+	void Init(int thread_count, int max_width, int max_height);
+	// lets the workers finish the current image and joins them
+	void Stop();
+	bool IsReady();
+	// false while the last image is still being encoded or its blocks were not released yet
+	// pixels have to stay valid until IsDone
+	bool Start(const uint8_t *pixels, int width, int height);
+	bool IsDone();
+	// the encoded blocks, from IsDone until Release
+	const uint8_t *Data();
+	size_t Size();
+	void Release();
+
+  private:
+	void Work();
+
+	std::vector<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	uint64_t _job = 0; // incremented for every image, workers wake up when it changes
+	bool _quit = false;
+	bool _busy = false;
+
+	const uint8_t *_pixels = nullptr;
+	int _width = 0, _height = 0;
+	int _block_rows = 0;
+	std::atomic<int> _next_row = {0};
+	std::atomic<int> _working = {0}; // workers that have not run out of rows yet
+	std::vector<uint8_t> _blocks;
+};
@@ -0,0 +1,299 @@
+#include "capturepool.h"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include <unistd.h>
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+const size_t SMALL_PAGE_SIZE = 4096;
+
+static size_t RoundUp(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+static const char *PagesName(CapturePages pages)
+{
+	switch (pages)
+	{
+	case CapturePages::Small:
+		return "4 KB pages";
+	case CapturePages::Transparent:
+		return "transparent huge pages";
+	case CapturePages::HugeTLB:
+		return "hugetlb pages";
+	}
+	return "unknown pages";
+}
+
+CapturePool::CapturePool()
+{
+	_xcb = nullptr;
+	_data = nullptr;
+	_size = 0;
+	_buffer_size = 0;
+	_pages = CapturePages::Small;
+	_locked = false;
+	_sysv = false;
+	_gl_buffer = 0;
+}
+
+bool CapturePool::Init(xcb_connection_t *xcb, size_t buffer_size, int buffer_count, bool lock)
+{
+	_xcb = xcb;
+	auto version = xcb_shm_query_version_reply(_xcb, xcb_shm_query_version(_xcb), nullptr);
+	if (version == nullptr)
+	{
+		printf("MIT-SHM not available, capturing through regular GetImage requests\n");
+		return false;
+	}
+	bool fd_passing = version->major_version > 1 || (version->major_version == 1 && version->minor_version >= 2);
+	free(version);
+
+	// every buffer starts on a huge page boundary, so no page is shared between two of them
+	_buffer_size = RoundUp(buffer_size, HUGE_PAGE_SIZE);
+	_size = _buffer_size * buffer_count;
+	// sizes and offsets within the segment are 32 bit in the protocol
+	if (_size > UINT32_MAX)
+	{
+		printf("%d capture buffers of %zu bytes do not fit in one MIT-SHM segment, capturing through regular GetImage requests\n",
+			   buffer_count, _buffer_size);
+		_size = 0;
+		return false;
+	}
+	if (!(fd_passing && MapMemfd()) && !MapSysV())
+	{
+		printf("Could not create shared memory segment of %zu bytes\n", _size);
+		return false;
+	}
+	if (lock)
+	{
+		_locked = mlock(_data, _size) == 0;
+		if (!_locked)
+			printf("Could not lock %zu bytes of capture buffers in memory, see ulimit -l\n", _size);
+	}
+	Prefault();
+
+	_buffers.resize(buffer_count);
+	for (int i = 0; i < buffer_count; i++)
+	{
+		_buffers[i] = CaptureBuffer{_data + i * _buffer_size, (uint32_t)(i * _buffer_size), CaptureOwner::Free, nullptr};
+	}
+	printf("Capturing through MIT-SHM, %d buffers of %.1f MB in %s%s\n",
+		   buffer_count, _buffer_size / 1e6, PagesName(_pages), _locked ? ", locked" : "");
+	return true;
+}
+
+bool CapturePool::MapMemfd()
+{
+	_pages = CapturePages::HugeTLB;
+	int fd = memfd_create("sinpin-capture", MFD_CLOEXEC | MFD_HUGETLB);
+	void *data = MAP_FAILED;
+	if (fd != -1 && ftruncate(fd, _size) == 0)
+	{
+		// fails right here if there are not enough huge pages reserved
+		data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	if (data == MAP_FAILED)
+	{
+		if (fd != -1)
+			close(fd);
+		_pages = CapturePages::Small;
+		fd = memfd_create("sinpin-capture", MFD_CLOEXEC);
+		if (fd == -1 || ftruncate(fd, _size) != 0)
+		{
+			if (fd != -1)
+				close(fd);
+			return false;
+		}
+		data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			return false;
+		}
+		if (madvise(data, _size, MADV_HUGEPAGE) == 0)
+			_pages = CapturePages::Transparent;
+	}
+	_data = (uint8_t *)data;
+
+	// xcb closes the fd once it is sent, the X server maps it on its side
+	_seg = xcb_generate_id(_xcb);
+	auto attach_err = xcb_request_check(_xcb, xcb_shm_attach_fd_checked(_xcb, _seg, fd, false));
+	if (attach_err != nullptr)
+	{
+		printf("Could not pass shared memory to X server. Error code: %d\n", attach_err->error_code);
+		free(attach_err);
+		munmap(_data, _size);
+		_data = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool CapturePool::MapSysV()
+{
+	_pages = CapturePages::HugeTLB;
+	int shm_id = shmget(IPC_PRIVATE, _size, IPC_CREAT | SHM_HUGETLB | 0600);
+	if (shm_id == -1)
+	{
+		_pages = CapturePages::Small;
+		shm_id = shmget(IPC_PRIVATE, _size, IPC_CREAT | 0600);
+		if (shm_id == -1)
+			return false;
+	}
+	void *data = shmat(shm_id, nullptr, 0);
+	if (data == (void *)-1)
+	{
+		shmctl(shm_id, IPC_RMID, nullptr);
+		return false;
+	}
+	_data = (uint8_t *)data;
+	_sysv = true;
+	if (_pages == CapturePages::Small && madvise(_data, _size, MADV_HUGEPAGE) == 0)
+		_pages = CapturePages::Transparent;
+
+	_seg = xcb_generate_id(_xcb);
+	auto attach_err = xcb_request_check(_xcb, xcb_shm_attach_checked(_xcb, _seg, shm_id, false));
+	// the segment is freed once both we and the X server have detached from it
+	shmctl(shm_id, IPC_RMID, nullptr);
+	if (attach_err != nullptr)
+	{
+		printf("Could not attach shared memory segment to X server. Error code: %d\n", attach_err->error_code);
+		free(attach_err);
+		shmdt(_data);
+		_data = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void CapturePool::Prefault()
+{
+	// take every page fault now instead of during the first captures
+	for (size_t offset = 0; offset < _size; offset += SMALL_PAGE_SIZE)
+	{
+		((volatile uint8_t *)_data)[offset] = 0;
+	}
+}
+
+void CapturePool::Destroy()
+{
+	if (_data == nullptr)
+	{
+		return;
+	}
+	for (auto &buffer : _buffers)
+	{
+		if (buffer.upload_fence != nullptr)
+			glDeleteSync(buffer.upload_fence);
+	}
+	if (_gl_buffer != 0)
+	{
+		// unpins the memory, which has to happen before it is unmapped
+		glDeleteBuffers(1, &_gl_buffer);
+		glFinish();
+		_gl_buffer = 0;
+	}
+	xcb_shm_detach(_xcb, _seg);
+	if (_locked)
+		munlock(_data, _size);
+	if (_sysv)
+		shmdt(_data);
+	else
+		munmap(_data, _size);
+	_data = nullptr;
+	_buffers.clear();
+}
+
+bool CapturePool::IsReady()
+{
+	return _data != nullptr;
+}
+
+xcb_shm_seg_t CapturePool::Segment()
+{
+	return _seg;
+}
+
+bool CapturePool::Pin()
+{
+	if (_data == nullptr || !glfwExtensionSupported("GL_AMD_pinned_memory"))
+	{
+		return false;
+	}
+	while (glGetError() != GL_NO_ERROR)
+	{
+	}
+	glGenBuffers(1, &_gl_buffer);
+	glBindBuffer(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, _gl_buffer);
+	glBufferData(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, _size, _data, GL_STREAM_DRAW);
+	glBindBuffer(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, 0);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		printf("Could not pin capture buffers for upload, copying them instead\n");
+		glDeleteBuffers(1, &_gl_buffer);
+		_gl_buffer = 0;
+		return false;
+	}
+	printf("Uploading captures straight from pinned shared memory\n");
+	return true;
+}
+
+bool CapturePool::IsPinned()
+{
+	return _gl_buffer != 0;
+}
+
+GLuint CapturePool::UploadBuffer()
+{
+	return _gl_buffer;
+}
+
+CaptureBuffer *CapturePool::Acquire()
+{
+	for (auto &buffer : _buffers)
+	{
+		if (buffer.owner == CaptureOwner::Upload && buffer.upload_fence != nullptr)
+		{
+			// the X server may only write into it again once the GPU has read the last capture
+			if (glClientWaitSync(buffer.upload_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+				continue;
+			glDeleteSync(buffer.upload_fence);
+			buffer.upload_fence = nullptr;
+			buffer.owner = CaptureOwner::Free;
+		}
+		if (buffer.owner == CaptureOwner::Free)
+		{
+			buffer.owner = CaptureOwner::Capture;
+			return &buffer;
+		}
+	}
+	return nullptr;
+}
+
+void CapturePool::StartUpload(CaptureBuffer *buffer)
+{
+	assert(buffer->owner == CaptureOwner::Capture);
+	buffer->owner = CaptureOwner::Upload;
+}
+
+void CapturePool::FinishUpload(CaptureBuffer *buffer)
+{
+	assert(buffer->owner == CaptureOwner::Upload);
+	if (_gl_buffer == 0)
+	{
+		// the driver copied the pixels during glTexSubImage2D
+		buffer->owner = CaptureOwner::Free;
+		return;
+	}
+	buffer->upload_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void CapturePool::Release(CaptureBuffer *buffer)
+{
+	assert(buffer->owner != CaptureOwner::Free);
+	buffer->owner = CaptureOwner::Free;
+}
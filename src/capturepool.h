@@ -0,0 +1,83 @@
+#pragma once
+#define GL_GLEXT_PROTOTYPES
+#include <GLFW/glfw3.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <xcb/shm.h>
+#include <xcb/xcb.h>
+
+// only defined by glext.h since 2013
+#ifndef GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD
+#define GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD 0x9160
+#endif
+
+// which stage a capture buffer belongs to, buffers go Free -> Capture -> Upload -> Free
+enum class CaptureOwner
+{
+	Free,
+	Capture, // the X server writes into it until the capture reply arrives
+	Upload,  // holds a finished capture until it is uploaded to its texture, or until the GPU has
+			 // read it when the pool is pinned
+};
+
+enum class CapturePages
+{
+	Small,
+	Transparent, // transparent huge pages were requested with madvise
+	HugeTLB,     // reserved huge pages, see /proc/sys/vm/nr_hugepages
+};
+
+struct CaptureBuffer
+{
+	uint8_t *data;
+	uint32_t offset; // into the shared memory segment, and into the upload buffer when pinned
+	CaptureOwner owner;
+	GLsync upload_fence; // signals once the GPU is done reading a pinned upload
+};
+
+// fixed size capture buffers in one MIT-SHM segment, mapped and faulted in once at startup
+// the segment is a memfd passed to the X server when it supports MIT-SHM 1.2, a SysV segment otherwise
+// With AMD_pinned_memory the segment doubles as a pixel unpack buffer, so textures are uploaded by
+// DMA straight from the memory the X server wrote into, without the driver copying it first.
+class CapturePool
+{
+  public:
+	CapturePool();
+	CapturePool(const CapturePool &) = delete;
+	CapturePool &operator=(const CapturePool &) = delete;
+
+	bool Init(xcb_connection_t *xcb, size_t buffer_size, int buffer_count, bool lock);
+	// detaches from the X server, has to happen before the connection is closed
+	void Destroy();
+	bool IsReady();
+	xcb_shm_seg_t Segment();
+	// makes the segment a GL buffer, needs a current context that supports AMD_pinned_memory
+	bool Pin();
+	bool IsPinned();
+	// bind as GL_PIXEL_UNPACK_BUFFER and upload from a buffer's offset
+	GLuint UploadBuffer();
+
+	// hands a free buffer to the capture stage, nullptr if all of them are in use
+	CaptureBuffer *Acquire();
+	void StartUpload(CaptureBuffer *buffer);
+	// after the upload commands for a buffer were issued, frees it right away or once the GPU read it
+	void FinishUpload(CaptureBuffer *buffer);
+	void Release(CaptureBuffer *buffer);
+
+  private:
+	bool MapMemfd();
+	bool MapSysV();
+	void Prefault();
+
+	xcb_connection_t *_xcb;
+	xcb_shm_seg_t _seg;
+	uint8_t *_data;
+	size_t _size;
+	size_t _buffer_size;
+	CapturePages _pages;
+	bool _locked;
+	bool _sysv; // a SysV segment instead of a memfd mapping
+	GLuint _gl_buffer;
+	std::vector<CaptureBuffer> _buffers;
+};
@@ -0,0 +1,421 @@
+#include "changes.h"
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const int HASH_LANES = 8;
+const int STRIPE_BYTES = HASH_LANES * 8;
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+// xored into the input before multiplying, so long runs of one color still spread over all bits
+const uint64_t HASH_KEY[HASH_LANES] = {
+	0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+	0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull};
+
+static uint64_t Avalanche(uint64_t h)
+{
+	h ^= h >> 37;
+	h *= PRIME64_2;
+	h ^= h >> 32;
+	return h;
+}
+
+// the partial stripe at the end of a row, in 4 byte pixels
+static void AccumulateTail(uint64_t acc[HASH_LANES], const uint8_t *p, int pixels)
+{
+	for (int i = 0; i < pixels; i++)
+	{
+		uint32_t v;
+		memcpy(&v, p + i * 4, 4);
+		uint64_t key = v ^ HASH_KEY[i % HASH_LANES];
+		acc[i % HASH_LANES] += (key & 0xffffffff) * ((key >> 16) | 1);
+	}
+}
+
+static uint64_t Fold(const uint64_t lanes[HASH_LANES], int width)
+{
+	uint64_t h = (uint64_t)width * PRIME64_1;
+	for (int l = 0; l < HASH_LANES; l++)
+	{
+		h ^= lanes[l];
+		h = ((h << 31) | (h >> 33)) * PRIME64_2;
+	}
+	return Avalanche(h);
+}
+
+static uint64_t Read64(const uint8_t *p)
+{
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+
+uint64_t HashRowScalar(const uint8_t *pixels, int width)
+{
+	int row_bytes = width * 4;
+	int stripes = row_bytes / STRIPE_BYTES;
+	uint64_t lanes[HASH_LANES];
+	for (int l = 0; l < HASH_LANES; l++)
+		lanes[l] = PRIME64_1 * (l + 1);
+	for (int s = 0; s < stripes; s++)
+	{
+		const uint8_t *p = pixels + s * STRIPE_BYTES;
+		for (int l = 0; l < HASH_LANES; l++)
+		{
+			uint64_t data = Read64(p + l * 8);
+			uint64_t data_key = data ^ HASH_KEY[l];
+			lanes[l] += (data_key & 0xffffffff) * (data_key >> 32) + Read64(p + (l ^ 1) * 8);
+		}
+	}
+	AccumulateTail(lanes, pixels + stripes * STRIPE_BYTES, (row_bytes - stripes * STRIPE_BYTES) / 4);
+	return Fold(lanes, width);
+}
+
+#ifdef __SSE2__
+uint64_t HashRow(const uint8_t *pixels, int width)
+{
+	int row_bytes = width * 4;
+	int stripes = row_bytes / STRIPE_BYTES;
+	__m128i acc[HASH_LANES / 2];
+	for (int l = 0; l < HASH_LANES / 2; l++)
+	{
+		acc[l] = _mm_set_epi64x(PRIME64_1 * (2 * l + 2), PRIME64_1 * (2 * l + 1));
+	}
+	for (int s = 0; s < stripes; s++)
+	{
+		const uint8_t *p = pixels + s * STRIPE_BYTES;
+		for (int l = 0; l < HASH_LANES / 2; l++)
+		{
+			__m128i data = _mm_loadu_si128((const __m128i *)(p + l * 16));
+			__m128i key = _mm_loadu_si128((const __m128i *)&HASH_KEY[l * 2]);
+			__m128i data_key = _mm_xor_si128(data, key);
+			__m128i product = _mm_mul_epu32(data_key, _mm_srli_epi64(data_key, 32));
+			// adding the data with its two 64 bit halves swapped keeps every input bit in the hash
+			__m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+			acc[l] = _mm_add_epi64(acc[l], _mm_add_epi64(product, swapped));
+		}
+	}
+	alignas(16) uint64_t lanes[HASH_LANES];
+	for (int l = 0; l < HASH_LANES / 2; l++)
+		_mm_store_si128((__m128i *)&lanes[l * 2], acc[l]);
+	AccumulateTail(lanes, pixels + stripes * STRIPE_BYTES, (row_bytes - stripes * STRIPE_BYTES) / 4);
+	return Fold(lanes, width);
+}
+#else
+uint64_t HashRow(const uint8_t *pixels, int width)
+{
+	return HashRowScalar(pixels, width);
+}
+#endif
+
+// a tile's hash from the hashes of its rows, in order
+static uint64_t CombineRows(const uint64_t *strips, int columns, int height)
+{
+	uint64_t h = PRIME64_1;
+	for (int y = 0; y < height; y++)
+	{
+		h ^= strips[y * columns];
+		h = ((h << 27) | (h >> 37)) * PRIME64_2;
+	}
+	return Avalanche(h);
+}
+
+void ChangeDetector::Init(int width, int height, bool detect_scrolls)
+{
+	_width = width;
+	_height = height;
+	_columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+	_rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+	_detect_scrolls = detect_scrolls;
+	_strips.assign(_height * _columns, 0);
+	_last_strips.assign(_height * _columns, 0);
+	_hashes.assign(_columns * _rows, 0);
+	_changed.assign(_columns * _rows, 0);
+	_pending.assign(_columns * _rows, 0);
+	_pending_count = 0;
+	_pending_since.assign(_columns * _rows, 0);
+	_priority.assign(_columns * _rows, 0);
+	_order.reserve(_columns * _rows);
+	_row_upload.assign(_height, 0);
+	_votes.assign(2 * MAX_SCROLL + 1, 0);
+	// at worst every other tile changed, and every other row of the scrolled columns
+	_runs.reserve(_rows * (_columns + 1) / 2 + (_height + 1) / 2 * _columns);
+	_shifts.reserve(_columns);
+	_valid = false;
+}
+
+int ChangeDetector::Update(const uint8_t *pixels, uint64_t now)
+{
+	_runs.clear();
+	_shifts.clear();
+	std::swap(_strips, _last_strips);
+	size_t stride = _width * 4;
+	for (int y = 0; y < _height; y++)
+	{
+		for (int column = 0; column < _columns; column++)
+		{
+			int x = column * TILE_SIZE;
+			_strips[y * _columns + column] = HashRow(pixels + y * stride + x * 4, std::min(TILE_SIZE, _width - x));
+		}
+	}
+
+	int changed = 0;
+	for (int row = 0; row < _rows; row++)
+	{
+		int y = row * TILE_SIZE;
+		int height = std::min(TILE_SIZE, _height - y);
+		for (int column = 0; column < _columns; column++)
+		{
+			int tile = row * _columns + column;
+			uint64_t hash = CombineRows(&_strips[y * _columns + column], _columns, height);
+			_changed[tile] = !_valid || hash != _hashes[tile];
+			_hashes[tile] = hash;
+			changed += _changed[tile];
+		}
+	}
+	if (_valid && _detect_scrolls && changed >= SCROLL_MIN_TILES)
+	{
+		DetectScroll();
+	}
+	_valid = true;
+
+	// tiles stay pending until they are uploaded, from this capture or a later one
+	for (int tile = 0; tile < TileCount(); tile++)
+	{
+		if (_changed[tile] && !_pending[tile])
+		{
+			_pending[tile] = true;
+			_pending_since[tile] = now;
+			_pending_count++;
+		}
+	}
+	return changed;
+}
+
+int ChangeDetector::Schedule(size_t *budget, int focus_x, int focus_y, uint64_t now, uint64_t deadline)
+{
+	_runs.clear();
+	_order.clear();
+	int focus_column = focus_x / TILE_SIZE;
+	int focus_row = focus_y / TILE_SIZE;
+	for (int tile = 0; tile < TileCount(); tile++)
+	{
+		if (!_pending[tile])
+			continue;
+		// overdue tiles first, then the ones closest to the focus, then top to bottom
+		uint64_t overdue = now - _pending_since[tile] >= deadline ? 0 : 1;
+		uint64_t distance = 0;
+		if (focus_x >= 0)
+		{
+			int dx = tile % _columns - focus_column;
+			int dy = tile / _columns - focus_row;
+			distance = dx * dx + dy * dy;
+		}
+		_priority[tile] = (overdue << 56) | (distance << 24) | tile;
+		_order.push_back(tile);
+	}
+	std::sort(_order.begin(), _order.end(), [this](int a, int b) { return _priority[a] < _priority[b]; });
+
+	// _changed marks the picked tiles from here on
+	int picked = 0;
+	for (int tile : _order)
+	{
+		int x = tile % _columns * TILE_SIZE;
+		int y = tile / _columns * TILE_SIZE;
+		size_t bytes = std::min(TILE_SIZE, _width - x) * std::min(TILE_SIZE, _height - y) * 4;
+		bool overdue = _priority[tile] >> 56 == 0;
+		if (!overdue && bytes > *budget)
+			break;
+		*budget -= std::min(bytes, *budget);
+		_pending[tile] = false;
+		_changed[tile] = true;
+		picked++;
+	}
+	_pending_count -= picked;
+
+	// the picked tiles, merged into runs along each row of tiles
+	for (int row = 0; row < _rows; row++)
+	{
+		int y = row * TILE_SIZE;
+		int height = std::min(TILE_SIZE, _height - y);
+		bool in_run = false;
+		for (int column = 0; column < _columns; column++)
+		{
+			int tile = row * _columns + column;
+			int x = column * TILE_SIZE;
+			int width = std::min(TILE_SIZE, _width - x);
+			if (!_changed[tile] || _pending[tile])
+			{
+				in_run = false;
+				continue;
+			}
+			_changed[tile] = false;
+			if (in_run)
+				_runs.back().width += width;
+			else
+				_runs.push_back(TileRun{x, y, width, height});
+			in_run = true;
+		}
+	}
+	return picked;
+}
+
+void ChangeDetector::MarkUploaded()
+{
+	std::fill(_pending.begin(), _pending.end(), 0);
+	_pending_count = 0;
+}
+
+bool ChangeDetector::HasPending()
+{
+	return _pending_count > 0;
+}
+
+bool ChangeDetector::RowMatches(int y, int column, int shift)
+{
+	// rows of tiles still waiting for their upload are not in the texture
+	int source = y + shift;
+	return source >= 0 && source < _height && !_pending[(source / TILE_SIZE) * _columns + column] &&
+		   _strips[y * _columns + column] == _last_strips[source * _columns + column];
+}
+
+void ChangeDetector::DetectScroll()
+{
+	// every distinctive row in a changed tile votes for the shifts that would bring an old row with the same
+	// hash to its place, rows that look like their neighbours (eg. plain background) would match anywhere
+	std::fill(_votes.begin(), _votes.end(), 0);
+	for (int column = 0; column < _columns; column++)
+	{
+		for (int row = 0; row < _rows; row++)
+		{
+			if (!_changed[row * _columns + column])
+				continue;
+			int end = std::min((row + 1) * TILE_SIZE, _height - 1);
+			for (int y = row * TILE_SIZE + 1; y < end; y += SCROLL_ANCHOR_STEP)
+			{
+				uint64_t hash = _strips[y * _columns + column];
+				if (hash == _strips[(y - 1) * _columns + column] || hash == _strips[(y + 1) * _columns + column])
+					continue;
+				int first = std::max(-MAX_SCROLL, -y);
+				int last = std::min(MAX_SCROLL, _height - 1 - y);
+				for (int shift = first; shift <= last; shift++)
+				{
+					if (_last_strips[(y + shift) * _columns + column] == hash)
+						_votes[shift + MAX_SCROLL]++;
+				}
+			}
+		}
+	}
+	int shift = 0;
+	int best_votes = SCROLL_MIN_VOTES - 1;
+	for (int i = 0; i < (int)_votes.size(); i++)
+	{
+		if (i != MAX_SCROLL && _votes[i] > best_votes)
+		{
+			best_votes = _votes[i];
+			shift = i - MAX_SCROLL;
+		}
+	}
+	if (shift == 0)
+	{
+		return;
+	}
+
+	// columns where most rows of the changed tiles are explained by the shift move on the GPU, in runs of
+	// neighbouring columns
+	int column = 0;
+	while (column < _columns)
+	{
+		int first_column = column;
+		int top = _height, bottom = -1;
+		for (; column < _columns; column++)
+		{
+			int rows = 0, matches = 0;
+			int column_top = _height, column_bottom = -1;
+			for (int y = 0; y < _height; y++)
+			{
+				if (!_changed[(y / TILE_SIZE) * _columns + column])
+					continue;
+				rows++;
+				if (!RowMatches(y, column, shift))
+					continue;
+				matches++;
+				// rows that are the same as before stay out of the copy where possible
+				if (_strips[y * _columns + column] != _last_strips[y * _columns + column])
+				{
+					column_top = std::min(column_top, y);
+					column_bottom = y;
+				}
+			}
+			if (rows == 0 || matches * 2 < rows || column_bottom < 0)
+				break;
+			top = std::min(top, column_top);
+			bottom = std::max(bottom, column_bottom);
+		}
+		if (column == first_column)
+		{
+			column++;
+			continue;
+		}
+		ShiftColumns(first_column, column, shift, top, bottom);
+	}
+}
+
+void ChangeDetector::ShiftColumns(int first_column, int end_column, int shift, int top, int bottom)
+{
+	int x = first_column * TILE_SIZE;
+	int width = std::min(end_column * TILE_SIZE, _width) - x;
+	_shifts.push_back(TileShift{x, width, top + shift, top, bottom - top + 1});
+
+	// after the copy, rows inside it are right only if they match in every column, and rows outside it
+	// only if they did not change and were uploaded before
+	for (int y = 0; y < _height; y++)
+	{
+		bool upload = false;
+		for (int column = first_column; column < end_column && !upload; column++)
+		{
+			if (y >= top && y <= bottom)
+				upload = !RowMatches(y, column, shift);
+			else
+				upload = _strips[y * _columns + column] != _last_strips[y * _columns + column] ||
+						 _pending[(y / TILE_SIZE) * _columns + column];
+		}
+		_row_upload[y] = upload;
+	}
+	for (int y = 0; y < _height; y++)
+	{
+		if (!_row_upload[y])
+			continue;
+		if (y > 0 && _row_upload[y - 1])
+			_runs.back().height++;
+		else
+			_runs.push_back(TileRun{x, y, width, 1});
+	}
+	for (int row = 0; row < _rows; row++)
+	{
+		for (int column = first_column; column < end_column; column++)
+		{
+			int tile = row * _columns + column;
+			_pending_count -= _pending[tile];
+			_changed[tile] = false;
+			_pending[tile] = false;
+		}
+	}
+}
+
+int ChangeDetector::TileCount()
+{
+	return _columns * _rows;
+}
+
+const std::vector<TileShift> &ChangeDetector::Shifts()
+{
+	return _shifts;
+}
+
+const std::vector<TileRun> &ChangeDetector::Runs()
+{
+	return _runs;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Finds the parts of a capture that differ from the previous one by hashing it in tiles, so only
+// those get uploaded. Works on any X server, since it only looks at the captured pixels.
+// Tile hashes are built from the hashes of their pixel rows, which also show when content scrolled:
+// that part of the texture is then moved on the GPU and only the newly exposed rows are uploaded.
+
+const int TILE_SIZE = 64; // pixels, 16 KB per full tile
+// scrolls are only looked for when this many tiles changed
+const int SCROLL_MIN_TILES = 4;
+// furthest content can move between two captures and still be recognized as a scroll
+const int MAX_SCROLL = 256;
+// rows of a changed tile that look for where they came from
+const int SCROLL_ANCHOR_STEP = 16;
+const int SCROLL_MIN_VOTES = 4;
+
+// rectangle of changed pixels, one or more neighbouring tiles in a row of tiles
+struct TileRun
+{
+	int x, y;
+	int width, height;
+};
+
+// 64 bit hash of width pixels in the style of xxh3: 8 lanes of 32x32 bit multiply-accumulate
+uint64_t HashRow(const uint8_t *pixels, int width);
+// the portable version of HashRow, which uses SSE2 where available, both return the same hashes
+uint64_t HashRowScalar(const uint8_t *pixels, int width);
+
+// content that moved up or down between two captures, rows src_y.. of the texture are copied to dst_y..
+struct TileShift
+{
+	int x, width;
+	int src_y, dst_y;
+	int height;
+};
+
+class ChangeDetector
+{
+  public:
+	// with detect_scrolls, content that moved vertically is found by comparing the hashes of single rows
+	void Init(int width, int height, bool detect_scrolls);
+	// hashes every tile of a capture and compares it with the previous one, returns the number changed
+	// changed tiles are pending from now (the capture time) until Schedule picks them
+	int Update(const uint8_t *pixels, uint64_t now);
+	// picks pending tiles to upload from the last capture, nearest to the focus pixel first (focus_x < 0
+	// for none), until their size exceeds budget. Tiles pending for deadline or longer are picked regardless.
+	// Subtracts their size from budget and returns how many were picked.
+	int Schedule(size_t *budget, int focus_x, int focus_y, uint64_t now, uint64_t deadline);
+	bool HasPending();
+	// the whole last capture was uploaded at once, without Schedule
+	void MarkUploaded();
+
+	int TileCount();
+	// copies within the texture that bring it closer to the last capture, to apply before uploading Runs()
+	const std::vector<TileShift> &Shifts();
+	// after Update: the rows a shift did not account for, to upload right after the shifts
+	// after Schedule: the picked tiles, merged into runs along each row of tiles
+	const std::vector<TileRun> &Runs();
+
+  private:
+	void DetectScroll();
+	bool RowMatches(int y, int column, int shift);
+	void ShiftColumns(int first_column, int end_column, int shift, int top, int bottom);
+
+	int _width, _height;
+	int _columns, _rows;
+	bool _detect_scrolls;
+	bool _valid = false;
+	// hash of every pixel row within every column of tiles, of this capture and the previous one
+	std::vector<uint64_t> _strips;
+	std::vector<uint64_t> _last_strips;
+	std::vector<uint64_t> _hashes;
+	std::vector<uint8_t> _changed;
+	// differs from the texture, the texture holds an older capture there
+	std::vector<uint8_t> _pending;
+	int _pending_count = 0;
+	std::vector<uint64_t> _pending_since;
+	std::vector<uint64_t> _priority;
+	std::vector<int> _order;
+	std::vector<uint8_t> _row_upload;
+	std::vector<int> _votes; // for every shift from -MAX_SCROLL to MAX_SCROLL
+	// reserved for the worst case, so they never grow while running
+	std::vector<TileShift> _shifts;
+	std::vector<TileRun> _runs;
+};
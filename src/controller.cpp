@@ -1,8 +1,10 @@
 #include "controller.h"
 #include "app.h"
+#include "mapping.h"
 #include "overlay.h"
+#include "profiler.h"
+#include "trace.h"
 #include "util.h"
-#include <string>
 
 const float LASER_WIDTH = 0.004f;
 const Color EDIT_COLOR{1, 0.6f, 1};
@@ -11,8 +13,12 @@ const float SCROLL_SPEED = 48;
 const float SCROLL_HAPTIC_STRENGTH = 0.15f;
 const float SCROLL_HAPTIC_TIME = 0.1f;
 const float MOUSE_DRAG_THRESHOLD = 48;
+// One Euro filter parameters for the laser position in pixels
+const float CURSOR_MIN_CUTOFF = 1.0f;
+const float CURSOR_BETA = 0.007f;
 
 Controller::Controller(App *app, ControllerSide side)
+	: _cursor_filter(CURSOR_MIN_CUTOFF, CURSOR_BETA)
 {
 	_grabbed_overlay = nullptr;
 	_app = app;
@@ -20,13 +26,7 @@ Controller::Controller(App *app, ControllerSide side)
 	_is_connected = false;
 	_side = side;
 
-	std::string laser_name = "controller_laser_";
-	if (side == ControllerSide::Left)
-		laser_name += "left";
-	else if (side == ControllerSide::Right)
-		laser_name += "right";
-
-	_laser = Overlay(app, laser_name);
+	_laser = Overlay(app, side == ControllerSide::Left ? "controller_laser_left" : "controller_laser_right");
 	UpdateStatus();
 	_laser.SetTextureToColor(255, 255, 255);
 	_laser.SetAlpha(0.2f);
@@ -75,6 +75,8 @@ glm::vec3 Controller::GetLastRot()
 
 void Controller::Update(float dtime)
 {
+	PROFILE_STAGE(_side == ControllerSide::Left ? Stage::ControllerLeft : Stage::ControllerRight);
+	TRACE_SCOPE(_side == ControllerSide::Left ? "Controller::Update left" : "Controller::Update right");
 	UpdateStatus();
 	if (!_is_connected)
 		return;
@@ -122,6 +124,8 @@ void Controller::Update(float dtime)
 				_app->_active_cursor = this;
 			}
 			_cursor_active = !_cursor_active;
+			// the filter's last position may be minutes old, start over instead of gliding in from there
+			_cursor_filter_panel = nullptr;
 			_app->_active_cursor = this;
 			_laser.SetColor(CURSOR_COLOR);
 		}
@@ -129,16 +133,15 @@ void Controller::Update(float dtime)
 		{
 			if (_last_ray.overlay != nullptr && _last_ray.hit_panel != nullptr)
 			{
-				auto pos = glm::vec2(_last_ray.local_pos.x, _last_ray.local_pos.y);
-				// normalize positions to +-0.5
-				pos /= _last_ray.overlay->Width();
-				pos.y *= -1;
-
-				// shift to 0-1
-				pos.x += 0.5f;
-				pos.y += 0.5f * _last_ray.overlay->Ratio();
+				auto pos = LaserToPixel(_last_ray.local_pos, _last_ray.overlay->Width(), _last_ray.overlay->Ratio(), _last_ray.hit_panel->Width());
 
-				pos *= _last_ray.hit_panel->Width();
+				// filtered coordinates are panel local, so start over when moving to another panel
+				if (_last_ray.hit_panel != _cursor_filter_panel)
+				{
+					_cursor_filter.Reset();
+					_cursor_filter_panel = _last_ray.hit_panel;
+				}
+				pos = _cursor_filter.Filter(pos, dtime);
 				if (glm::length(pos - _last_set_mouse_pos) > MOUSE_DRAG_THRESHOLD)
 				{
 					_mouse_drag_lock = false;
@@ -149,28 +152,21 @@ void Controller::Update(float dtime)
 					_last_set_mouse_pos = pos;
 				}
 			}
+			else
+			{
+				_cursor_filter_panel = nullptr;
+			}
 			UpdateMouseButton(_app->_input_handles.cursor.mouse_left, 1);
 			UpdateMouseButton(_app->_input_handles.cursor.mouse_middle, 2);
 			UpdateMouseButton(_app->_input_handles.cursor.mouse_right, 3);
 			auto scroll_state = _app->GetInputAnalog(_app->_input_handles.cursor.scroll, _input_handle);
 			if (scroll_state.y != 0)
 			{
-				_last_sent_scroll += dtime * glm::abs(scroll_state.y) * SCROLL_SPEED;
-				if (_last_sent_scroll > 1)
+				int notches = _app->SendScroll(dtime * scroll_state.y * SCROLL_SPEED);
+				if (notches != 0)
 				{
-					_last_sent_scroll = 0;
-					if (scroll_state.y > 0)
-					{
-						_app->SendMouseInput(4, true);
-						_app->SendMouseInput(4, false);
-						_app->vr_input->TriggerHapticVibrationAction(_app->_input_handles.cursor.scroll_haptic, 0, SCROLL_HAPTIC_TIME, 1 / SCROLL_HAPTIC_TIME, SCROLL_HAPTIC_STRENGTH, _input_handle);
-					}
-					else if (scroll_state.y < 0)
-					{
-						_app->SendMouseInput(5, true);
-						_app->SendMouseInput(5, false);
-						_app->vr_input->TriggerHapticVibrationAction(_app->_input_handles.cursor.scroll_haptic, 0, SCROLL_HAPTIC_TIME, 1 / SCROLL_HAPTIC_TIME, SCROLL_HAPTIC_STRENGTH, _input_handle);
-					}
+					TRACE_SCOPE("IVRInput::TriggerHapticVibrationAction");
+					_app->vr_input->TriggerHapticVibrationAction(_app->_input_handles.cursor.scroll_haptic, 0, SCROLL_HAPTIC_TIME, 1 / SCROLL_HAPTIC_TIME, SCROLL_HAPTIC_STRENGTH, _input_handle);
 				}
 			}
 		}
@@ -200,17 +196,14 @@ void Controller::UpdateLaser()
 	_last_ray = ray;
 
 	auto hmd_global_pos = GetPos(_app->GetTrackerPose(0));
-	auto hmd_local_pos = glm::inverse(controller_pose) * glm::vec4(hmd_global_pos - controller_pos, 0);
-	hmd_local_pos.z = 0;
-	auto hmd_dir = glm::normalize(hmd_local_pos);
-
-	VRMat transform = {{{LASER_WIDTH * hmd_dir.y, 0, LASER_WIDTH * hmd_dir.x, 0}, {LASER_WIDTH * -hmd_dir.x, 0, LASER_WIDTH * hmd_dir.y, 0}, {0, len, 0, len * -0.5f}}};
+	VRMat transform = LaserTransform(controller_pose, hmd_global_pos, len, LASER_WIDTH);
 	_laser.SetTransformTracker(_device_index, &transform);
 	_laser.SetHidden(!_is_connected || _app->_hidden || (!_app->_edit_mode && !_cursor_active));
 }
 
 void Controller::UpdateStatus()
 {
+	TRACE_SCOPE("Controller::UpdateStatus");
 	_is_connected = true;
 
 	if (_side == ControllerSide::Left)
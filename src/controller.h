@@ -1,4 +1,5 @@
 #pragma once
+#include "filter.h"
 #include "overlay.h"
 #include "util.h"
 #include <vector>
@@ -50,7 +51,8 @@ class Controller
 	glm::vec3 _last_rotation;
 	glm::vec3 _last_pos;
 
-	float _last_sent_scroll = 0;
 	bool _mouse_drag_lock = false;
 	glm::vec2 _last_set_mouse_pos;
+	OneEuroFilter _cursor_filter;
+	Panel *_cursor_filter_panel = nullptr;
 };
@@ -0,0 +1,39 @@
+#include "filter.h"
+
+static float SmoothingFactor(float dtime, float cutoff)
+{
+	float r = 2.0f * 3.14159265f * cutoff * dtime;
+	return r / (r + 1.0f);
+}
+
+OneEuroFilter::OneEuroFilter(float min_cutoff, float beta, float derivative_cutoff)
+	: _min_cutoff(min_cutoff),
+	  _beta(beta),
+	  _derivative_cutoff(derivative_cutoff)
+{
+	Reset();
+}
+
+void OneEuroFilter::Reset()
+{
+	_initialized = false;
+	_last_value = glm::vec2(0);
+	_last_derivative = glm::vec2(0);
+}
+
+glm::vec2 OneEuroFilter::Filter(glm::vec2 value, float dtime)
+{
+	if (!_initialized || dtime <= 0)
+	{
+		_initialized = true;
+		_last_value = value;
+		_last_derivative = glm::vec2(0);
+		return value;
+	}
+	auto derivative = (value - _last_value) / dtime;
+	_last_derivative += (derivative - _last_derivative) * SmoothingFactor(dtime, _derivative_cutoff);
+
+	float cutoff = _min_cutoff + _beta * glm::length(_last_derivative);
+	_last_value += (value - _last_value) * SmoothingFactor(dtime, cutoff);
+	return _last_value;
+}
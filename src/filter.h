@@ -0,0 +1,22 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// One Euro filter (Casiez et al. 2012), a low pass filter that raises its cutoff frequency with speed.
+// Holding still removes jitter, while fast movements get through with little lag.
+class OneEuroFilter
+{
+  public:
+	OneEuroFilter(float min_cutoff, float beta, float derivative_cutoff = 1.0f);
+
+	glm::vec2 Filter(glm::vec2 value, float dtime);
+	void Reset();
+
+  private:
+	float _min_cutoff;
+	float _beta;
+	float _derivative_cutoff;
+
+	bool _initialized;
+	glm::vec2 _last_value;
+	glm::vec2 _last_derivative;
+};
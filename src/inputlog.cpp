@@ -0,0 +1,250 @@
+#include "inputlog.h"
+#include "app.h"
+#include "trace.h"
+#include <cstring>
+
+const char INPUT_LOG_MAGIC[4] = {'S', 'P', 'I', 'L'};
+const uint32_t INPUT_LOG_VERSION = 2;
+
+struct InputLogHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t frame_size; // catches logs written with a different layout of InputLogFrame
+	uint32_t _padding;
+};
+
+InputLog::~InputLog()
+{
+	if (_file == nullptr)
+	{
+		return;
+	}
+	fclose(_file);
+	if (_recording)
+		printf("Recorded %lu frames of input\n", _frame_count);
+	else
+		printf("Replayed %lu frames of input\n", _frame_count);
+}
+
+bool InputLog::Open(App *app, const char *path, const char *mode)
+{
+	_app = app;
+	_file = fopen(path, mode);
+	if (_file == nullptr)
+	{
+		printf("Could not open input log %s\n", path);
+		return false;
+	}
+	ReadActionHandles();
+	return true;
+}
+
+bool InputLog::StartRecording(App *app, const char *path)
+{
+	if (!Open(app, path, "wb"))
+	{
+		return false;
+	}
+	InputLogHeader header;
+	memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+	header.version = INPUT_LOG_VERSION;
+	header.frame_size = sizeof(InputLogFrame);
+	header._padding = 0;
+	fwrite(&header, sizeof(header), 1, _file);
+	_recording = true;
+	printf("Recording input to %s\n", path);
+	return true;
+}
+
+bool InputLog::StartReplay(App *app, const char *path)
+{
+	if (!Open(app, path, "rb"))
+	{
+		return false;
+	}
+	InputLogHeader header;
+	if (fread(&header, sizeof(header), 1, _file) != 1 ||
+		memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != INPUT_LOG_VERSION ||
+		header.frame_size != sizeof(InputLogFrame))
+	{
+		printf("%s is not an input log made by this version\n", path);
+		fclose(_file);
+		_file = nullptr;
+		return false;
+	}
+	_replaying = true;
+	printf("Replaying input from %s\n", path);
+	return true;
+}
+
+bool InputLog::IsRecording()
+{
+	return _recording;
+}
+
+bool InputLog::IsReplaying()
+{
+	return _replaying;
+}
+
+bool InputLog::ReplayFinished()
+{
+	return _replay_finished;
+}
+
+void InputLog::ReadActionHandles()
+{
+	auto &handles = _app->_input_handles;
+	vr::VRActionHandle_t digital[INPUT_LOG_DIGITAL_ACTIONS] = {
+		handles.main.toggle_hidden,
+		handles.main.edit_mode,
+		handles.main.reset,
+		handles.cursor.activate,
+		handles.cursor.mouse_left,
+		handles.cursor.mouse_right,
+		handles.cursor.mouse_middle,
+		handles.cursor.toggle_transparent,
+		handles.edit.grab,
+	};
+	vr::VRActionHandle_t analog[INPUT_LOG_ANALOG_ACTIONS] = {
+		handles.cursor.scroll,
+		handles.edit.distance,
+	};
+	memcpy(_digital_actions, digital, sizeof(digital));
+	memcpy(_analog_actions, analog, sizeof(analog));
+}
+
+TrackerID InputLog::PoseDevice(int pose)
+{
+	if (pose == 0)
+		return vr::k_unTrackedDeviceIndex_Hmd;
+	auto &controller = _app->_controllers[pose - 1];
+	return controller.has_value() ? controller->DeviceIndex() : vr::k_unTrackedDeviceIndexInvalid;
+}
+
+int InputLog::SourceIndex(vr::VRInputValueHandle_t source)
+{
+	if (source == vr::k_ulInvalidInputValueHandle)
+		return 0;
+	for (int i = 0; i < 2; i++)
+	{
+		if (_app->_controllers[i].has_value() && _app->_controllers[i]->InputHandle() == source)
+			return i + 1;
+	}
+	return -1;
+}
+
+void InputLog::RecordFrame(float dtime)
+{
+	TRACE_SCOPE("InputLog::RecordFrame");
+	memset(&_frame, 0, sizeof(_frame));
+	_frame.dtime = dtime;
+	for (int i = 0; i < INPUT_LOG_POSES; i++)
+	{
+		TrackerID device = PoseDevice(i);
+		if (device >= MAX_TRACKERS)
+			continue;
+		auto &pose = _app->_tracker_poses[device];
+		_frame.poses[i] = pose.mDeviceToAbsoluteTracking;
+		_frame.pose_flags[i] = (pose.bPoseIsValid ? InputLogFlags_Active : 0) | (pose.bDeviceIsConnected ? InputLogFlags_Connected : 0);
+	}
+	vr::VRInputValueHandle_t sources[INPUT_LOG_SOURCES] = {vr::k_ulInvalidInputValueHandle, 0, 0};
+	for (int i = 0; i < 2; i++)
+	{
+		if (_app->_controllers[i].has_value())
+			sources[i + 1] = _app->_controllers[i]->InputHandle();
+	}
+	for (int s = 0; s < INPUT_LOG_SOURCES; s++)
+	{
+		for (int a = 0; a < INPUT_LOG_DIGITAL_ACTIONS; a++)
+		{
+			vr::InputDigitalActionData_t data;
+			if (_app->vr_input->GetDigitalActionData(_digital_actions[a], &data, sizeof(data), sources[s]) != vr::VRInputError_None)
+				continue;
+			_frame.digital[a][s] = (data.bActive ? InputLogFlags_Active : 0) | (data.bState ? InputLogFlags_State : 0) | (data.bChanged ? InputLogFlags_Changed : 0);
+		}
+		for (int a = 0; a < INPUT_LOG_ANALOG_ACTIONS; a++)
+		{
+			vr::InputAnalogActionData_t data;
+			if (_app->vr_input->GetAnalogActionData(_analog_actions[a], &data, sizeof(data), sources[s]) != vr::VRInputError_None)
+				continue;
+			_frame.analog[a][s][0] = data.x;
+			_frame.analog[a][s][1] = data.y;
+			_frame.analog_flags[a][s] = data.bActive ? InputLogFlags_Active : 0;
+		}
+	}
+	fwrite(&_frame, sizeof(_frame), 1, _file);
+	_frame_count++;
+}
+
+bool InputLog::ReplayFrame(float *dtime)
+{
+	TRACE_SCOPE("InputLog::ReplayFrame");
+	if (fread(&_frame, sizeof(_frame), 1, _file) != 1)
+	{
+		memset(&_frame, 0, sizeof(_frame));
+		_replay_finished = true;
+		return false;
+	}
+	_frame_count++;
+	*dtime = _frame.dtime;
+	for (int i = 0; i < INPUT_LOG_POSES; i++)
+	{
+		TrackerID device = PoseDevice(i);
+		if (device >= MAX_TRACKERS)
+			continue;
+		auto &pose = _app->_tracker_poses[device];
+		pose.mDeviceToAbsoluteTracking = _frame.poses[i];
+		pose.bPoseIsValid = _frame.pose_flags[i] & InputLogFlags_Active;
+		pose.bDeviceIsConnected = _frame.pose_flags[i] & InputLogFlags_Connected;
+		pose.eTrackingResult = pose.bPoseIsValid ? vr::TrackingResult_Running_OK : vr::TrackingResult_Uninitialized;
+	}
+	return true;
+}
+
+vr::InputDigitalActionData_t InputLog::GetDigital(vr::VRActionHandle_t action, vr::VRInputValueHandle_t source)
+{
+	vr::InputDigitalActionData_t data = {};
+	int s = SourceIndex(source);
+	if (s < 0)
+	{
+		return data;
+	}
+	for (int a = 0; a < INPUT_LOG_DIGITAL_ACTIONS; a++)
+	{
+		if (_digital_actions[a] == action)
+		{
+			uint8_t flags = _frame.digital[a][s];
+			data.bActive = flags & InputLogFlags_Active;
+			data.bState = flags & InputLogFlags_State;
+			data.bChanged = flags & InputLogFlags_Changed;
+			data.activeOrigin = source;
+			break;
+		}
+	}
+	return data;
+}
+
+vr::InputAnalogActionData_t InputLog::GetAnalog(vr::VRActionHandle_t action, vr::VRInputValueHandle_t source)
+{
+	vr::InputAnalogActionData_t data = {};
+	int s = SourceIndex(source);
+	if (s < 0)
+	{
+		return data;
+	}
+	for (int a = 0; a < INPUT_LOG_ANALOG_ACTIONS; a++)
+	{
+		if (_analog_actions[a] == action)
+		{
+			data.bActive = _frame.analog_flags[a][s] & InputLogFlags_Active;
+			data.x = _frame.analog[a][s][0];
+			data.y = _frame.analog[a][s][1];
+			data.activeOrigin = source;
+			break;
+		}
+	}
+	return data;
+}
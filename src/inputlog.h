@@ -0,0 +1,73 @@
+#pragma once
+#include "util.h"
+#include <cstdio>
+
+class App;
+
+// every action the app reads, in the order they are stored in the log
+const int INPUT_LOG_DIGITAL_ACTIONS = 9;
+const int INPUT_LOG_ANALOG_ACTIONS = 2;
+// any device, left hand, right hand
+const int INPUT_LOG_SOURCES = 3;
+// hmd, left hand, right hand; stored by role because device indices differ between runtimes
+const int INPUT_LOG_POSES = 3;
+
+enum InputLogFlags
+{
+	InputLogFlags_Active = 1, // actions: bActive, poses: bPoseIsValid
+	InputLogFlags_State = 2,
+	InputLogFlags_Changed = 4,
+	InputLogFlags_Connected = 8,
+};
+
+struct InputLogFrame
+{
+	float dtime;
+	VRMat poses[INPUT_LOG_POSES];
+	float analog[INPUT_LOG_ANALOG_ACTIONS][INPUT_LOG_SOURCES][2];
+	uint8_t pose_flags[INPUT_LOG_POSES];
+	uint8_t digital[INPUT_LOG_DIGITAL_ACTIONS][INPUT_LOG_SOURCES];
+	uint8_t analog_flags[INPUT_LOG_ANALOG_ACTIONS][INPUT_LOG_SOURCES];
+};
+
+// Records the controller poses and action states of every frame to a file, or plays such a file
+// back in place of live input so the same session can be run against different builds.
+class InputLog
+{
+  public:
+	InputLog() = default;
+	InputLog(const InputLog &) = delete;
+	InputLog &operator=(const InputLog &) = delete;
+	~InputLog();
+
+	bool StartRecording(App *app, const char *path);
+	bool StartReplay(App *app, const char *path);
+	bool IsRecording();
+	bool IsReplaying();
+	bool ReplayFinished();
+
+	// called once per frame after the action state and poses have been updated
+	void RecordFrame(float dtime);
+	// replaces the poses of this frame with the recorded ones, returns false at the end of the log
+	bool ReplayFrame(float *dtime);
+
+	vr::InputDigitalActionData_t GetDigital(vr::VRActionHandle_t action, vr::VRInputValueHandle_t source);
+	vr::InputAnalogActionData_t GetAnalog(vr::VRActionHandle_t action, vr::VRInputValueHandle_t source);
+
+  private:
+	bool Open(App *app, const char *path, const char *mode);
+	void ReadActionHandles();
+	TrackerID PoseDevice(int pose);
+	int SourceIndex(vr::VRInputValueHandle_t source);
+
+	App *_app = nullptr;
+	FILE *_file = nullptr;
+	bool _recording = false;
+	bool _replaying = false;
+	bool _replay_finished = false;
+	uint64_t _frame_count = 0;
+	InputLogFrame _frame;
+
+	vr::VRActionHandle_t _digital_actions[INPUT_LOG_DIGITAL_ACTIONS];
+	vr::VRActionHandle_t _analog_actions[INPUT_LOG_ANALOG_ACTIONS];
+};
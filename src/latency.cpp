@@ -0,0 +1,188 @@
+#include "latency.h"
+#include "app.h"
+
+const int STAMP_X = 0;
+const int STAMP_Y = 0;
+
+static const char *StageName(LatencyStage stage)
+{
+	switch (stage)
+	{
+	case LatencyStage::Capture:
+		return "paint to capture";
+	case LatencyStage::Upload:
+		return "paint to upload";
+	case LatencyStage::Submit:
+		return "paint to submit";
+	}
+	return "unknown";
+}
+
+void LatencyProbe::Stop()
+{
+	if (_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &_framebuffer);
+		_framebuffer = 0;
+	}
+	if (_window != 0)
+	{
+		XFreeGC(_app->_xdisplay, _gc);
+		XDestroyWindow(_app->_xdisplay, _window);
+		_window = 0;
+	}
+}
+
+void LatencyProbe::Start(App *app)
+{
+	_app = app;
+	// an override redirect window stays exactly where it is put, even with a window manager running
+	XSetWindowAttributes attributes;
+	attributes.override_redirect = true;
+	attributes.background_pixel = BlackPixel(app->_xdisplay, 0);
+	_window = XCreateWindow(
+		app->_xdisplay, app->_root_window,
+		STAMP_X, STAMP_Y, STAMP_WIDTH, STAMP_HEIGHT, 0,
+		CopyFromParent, InputOutput, CopyFromParent,
+		CWOverrideRedirect | CWBackPixel, &attributes);
+	XMapRaised(app->_xdisplay, _window);
+	_gc = XCreateGC(app->_xdisplay, _window, 0, nullptr);
+	glGenFramebuffers(1, &_framebuffer);
+	printf("Measuring content latency with a stamp at (%d, %d)\n", STAMP_X, STAMP_Y);
+}
+
+bool LatencyProbe::IsEnabled()
+{
+	return _window != 0;
+}
+
+void LatencyProbe::Paint()
+{
+	_sequence = (_sequence + 1) % STAMP_HISTORY;
+	auto display = _app->_xdisplay;
+	unsigned long white = WhitePixel(display, 0);
+	unsigned long black = BlackPixel(display, 0);
+	XRaiseWindow(display, _window);
+	for (int cell = 0; cell < STAMP_BITS + 2; cell++)
+	{
+		bool on;
+		if (cell == 0)
+			on = true;
+		else if (cell == STAMP_BITS + 1)
+			on = false;
+		else
+			on = (_sequence >> (STAMP_BITS - cell)) & 1;
+		XSetForeground(display, _gc, on ? white : black);
+		XFillRectangle(display, _window, _gc, cell * STAMP_CELL_WIDTH, 0, STAMP_CELL_WIDTH, STAMP_HEIGHT);
+	}
+	XFlush(display);
+	_paint_times[_sequence] = ClockNanoseconds(CLOCK_MONOTONIC);
+}
+
+int LatencyProbe::Decode(const uint8_t *pixels, int stride)
+{
+	// middle of each cell, green channel of BGRA
+	const uint8_t *row = pixels + (STAMP_HEIGHT / 2) * stride;
+	int value = 0;
+	for (int cell = 0; cell < STAMP_BITS + 2; cell++)
+	{
+		bool on = row[(cell * STAMP_CELL_WIDTH + STAMP_CELL_WIDTH / 2) * 4 + 1] > 127;
+		if (cell == 0 && !on)
+			return -1;
+		if (cell == STAMP_BITS + 1 && on)
+			return -1;
+		if (cell > 0 && cell <= STAMP_BITS)
+			value = value << 1 | on;
+	}
+	return value;
+}
+
+void LatencyProbe::Record(LatencyStage stage, int sequence)
+{
+	uint64_t paint_time = _paint_times[sequence];
+	if (paint_time == 0)
+	{
+		return;
+	}
+	_histograms[(int)stage].Record(ClockNanoseconds(CLOCK_MONOTONIC) - paint_time);
+}
+
+void LatencyProbe::OnCapture(int panel, int panel_x, int panel_y, int panel_width, int panel_height, const uint8_t *pixels)
+{
+	int local_x = STAMP_X - panel_x;
+	int local_y = STAMP_Y - panel_y;
+	if (local_x < 0 || local_y < 0 || local_x + STAMP_WIDTH > panel_width || local_y + STAMP_HEIGHT > panel_height)
+	{
+		return;
+	}
+	_stamp_panel = panel;
+	_local_x = local_x;
+	_local_y = local_y;
+	int stride = panel_width * 4;
+	_captured_sequence = Decode(pixels + _local_y * stride + _local_x * 4, stride);
+	if (_captured_sequence < 0)
+	{
+		_unreadable++;
+		return;
+	}
+	Record(LatencyStage::Capture, _captured_sequence);
+}
+
+void LatencyProbe::OnUpload(int panel, GLuint texture)
+{
+	if (panel != _stamp_panel || _captured_sequence < 0)
+	{
+		return;
+	}
+	// reading the stamp back waits for the upload to finish, which is the point
+	uint8_t pixels[STAMP_WIDTH * STAMP_HEIGHT * 4];
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	glReadPixels(_local_x, _local_y, STAMP_WIDTH, STAMP_HEIGHT, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	int sequence = Decode(pixels, STAMP_WIDTH * 4);
+	if (sequence != _captured_sequence)
+	{
+		_unreadable++;
+		_captured_sequence = -1;
+		return;
+	}
+	Record(LatencyStage::Upload, sequence);
+}
+
+void LatencyProbe::OnSubmit(int panel)
+{
+	if (panel != _stamp_panel || _captured_sequence < 0)
+	{
+		return;
+	}
+	Record(LatencyStage::Submit, _captured_sequence);
+	_captured_sequence = -1;
+}
+
+void LatencyProbe::Report()
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+	printf("%-18s %8s %10s %10s %10s\n", "latency (ms)", "count", "p50", "p99", "max");
+	for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+	{
+		auto hist = &_histograms[i];
+		printf("%-18s %8lu %10.2f %10.2f %10.2f\n",
+			   StageName((LatencyStage)i),
+			   hist->Count(),
+			   hist->Percentile(50) / 1e6,
+			   hist->Percentile(99) / 1e6,
+			   hist->Max() / 1e6);
+	}
+	if (_histograms[(int)LatencyStage::Capture].Count() == 0)
+	{
+		printf("The stamp was never captured, is there a monitor at (%d, %d)?\n", STAMP_X, STAMP_Y);
+	}
+	if (_unreadable)
+	{
+		printf("%lu stamps could not be read back\n", _unreadable);
+	}
+}
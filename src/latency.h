@@ -0,0 +1,64 @@
+#pragma once
+#define GL_GLEXT_PROTOTYPES
+#include "profiler.h"
+#include <GLFW/glfw3.h>
+#include <X11/Xlib.h>
+
+class App;
+
+// the stamp is a row of cells in the top left corner of the root window: a white start cell, the
+// sequence number from the most significant bit, and a black end cell
+const int STAMP_BITS = 12; // wraps after 34 seconds at 120 updates per second
+const int STAMP_CELL_WIDTH = 4;
+const int STAMP_WIDTH = (STAMP_BITS + 2) * STAMP_CELL_WIDTH;
+const int STAMP_HEIGHT = 8;
+const int STAMP_HISTORY = 1 << STAMP_BITS;
+
+enum class LatencyStage
+{
+	Capture, // capture reply received
+	Upload,  // texture contains the stamp (read back, so the upload has finished)
+	Submit,  // SetOverlayTexture returned
+};
+const int LATENCY_STAGE_COUNT = (int)LatencyStage::Submit + 1;
+
+// Measures how old screen content is when it reaches SteamVR (--latency-probe). A sequence number is
+// painted into a small window every update, and decoded again from the capture and from the texture.
+// Meant for test displays like Xvfb, as the stamp sits on top of whatever is in the corner.
+class LatencyProbe
+{
+  public:
+	LatencyProbe() = default;
+	LatencyProbe(const LatencyProbe &) = delete;
+	LatencyProbe &operator=(const LatencyProbe &) = delete;
+
+	void Start(App *app);
+	// frees the stamp window and the read back framebuffer, needs the GL context
+	void Stop();
+	bool IsEnabled();
+	void Paint();
+
+	// called by every panel with its captured pixels, only the one that holds the stamp's corner is
+	// followed through upload and submit, the others are ignored
+	void OnCapture(int panel, int panel_x, int panel_y, int panel_width, int panel_height, const uint8_t *pixels);
+	void OnUpload(int panel, GLuint texture);
+	void OnSubmit(int panel);
+	void Report();
+
+  private:
+	void Record(LatencyStage stage, int sequence);
+	int Decode(const uint8_t *pixels, int stride);
+
+	App *_app = nullptr;
+	Window _window = 0;
+	GC _gc;
+	GLuint _framebuffer = 0;
+	int _sequence = 0;
+	uint64_t _paint_times[STAMP_HISTORY] = {};
+	int _stamp_panel = -1;       // index of the panel the stamp was captured by
+	int _captured_sequence = -1; // stamp in that panel's capture that is being processed, -1 if none
+	int _local_x;
+	int _local_y;
+	uint64_t _unreadable = 0;
+	Histogram _histograms[LATENCY_STAGE_COUNT];
+};
@@ -1,26 +1,234 @@
+#include "allocs.h"
 #include "app.h"
+#include "perfcounters.h"
+#include "profiler.h"
+#include "trace.h"
+#include <cstring>
 #include <signal.h>
 
 #define UPDATE_RATE 120
 
 bool should_exit = false;
+bool should_write_trace = false;
+bool should_reset_profile = false;
 
 void interrupted(int _sig)
 {
 	should_exit = true;
 }
 
-int main()
+void write_trace(int _sig)
 {
+	should_write_trace = true;
+}
+
+void reset_profile(int _sig)
+{
+	should_reset_profile = true;
+}
+
+void print_usage()
+{
+	printf("usage: sinpin_vr [options]\n");
+	printf("  --trace <file>    record a Chrome trace of the frame loop, written on exit or on SIGUSR1\n");
+	printf("  --perf-counters   report cycles, IPC, cache misses and page faults per stage (needs make profile)\n");
+	printf("  --stats <file>    write stage latencies and capture counters as json on exit (needs make profile)\n");
+	printf("  --record <file>   log controller poses and actions of every frame\n");
+	printf("  --replay <file>   use a recorded log instead of live input, exits at its end\n");
+	printf("  --replay-speed <x>  replay faster than real time, 0 runs frames back to back\n");
+	printf("  --latency-probe   paint a timestamp in the top left corner and report how long it takes to reach SteamVR\n");
+	printf("  --capture <shm|getimage>  how to read the screen, default shm\n");
+	printf("  --upload <pinned|copy>    upload from pinned shared memory if the driver supports it, default pinned\n");
+	printf("  --input <uinput|xtest>    inject pointer and scroll input through uinput devices or XTest, default uinput\n");
+	printf("  --full-uploads    upload whole captures instead of only the tiles that changed\n");
+	printf("  --no-scroll       upload scrolled content again instead of moving it within the texture\n");
+	printf("  --upload-budget <MB>      upload at most this much per update, spreading big changes over several, default 16, 0 for no limit\n");
+	printf("  --upload-deadline <ms>    upload tiles that waited this long regardless of the budget, default 100\n");
+	printf("  --compress-idle <s>       show panels that did not change for this long as BC1 textures, 8x smaller\n");
+	printf("  --frame-interval <n>      capture the screen every n updates, default 4\n");
+	printf("  --lock-memory     keep the capture buffers locked in RAM (mlock)\n");
+	printf("  --alloc-warmup <n>        frames before allocations count against the check (needs make alloccheck)\n");
+}
+
+int main(int argc, char **argv)
+{
+	AppOptions options;
+	const char *stats_path = nullptr;
+	const char *record_path = nullptr;
+	const char *replay_path = nullptr;
+	float replay_speed = 1;
+	bool latency_probe = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			Trace::Start(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--perf-counters") == 0)
+		{
+#ifdef SINPIN_PROFILE
+			PerfCounters::Start();
+#else
+			printf("--perf-counters only works in builds made with 'make profile'\n");
+#endif
+		}
+		else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+		{
+#ifdef SINPIN_PROFILE
+			stats_path = argv[++i];
+#else
+			printf("--stats only works in builds made with 'make profile'\n");
+			i++;
+#endif
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			record_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replay_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc)
+		{
+			replay_speed = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--latency-probe") == 0)
+		{
+			latency_probe = true;
+		}
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+		{
+			i++;
+			if (strcmp(argv[i], "shm") == 0)
+				options.capture = CaptureBackend::Shm;
+			else if (strcmp(argv[i], "getimage") == 0)
+				options.capture = CaptureBackend::GetImage;
+			else
+			{
+				print_usage();
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--upload") == 0 && i + 1 < argc)
+		{
+			i++;
+			if (strcmp(argv[i], "pinned") == 0)
+				options.upload = UploadBackend::Pinned;
+			else if (strcmp(argv[i], "copy") == 0)
+				options.upload = UploadBackend::Copy;
+			else
+			{
+				print_usage();
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc)
+		{
+			i++;
+			if (strcmp(argv[i], "uinput") == 0)
+				options.input = InputBackend::UInput;
+			else if (strcmp(argv[i], "xtest") == 0)
+				options.input = InputBackend::XTest;
+			else
+			{
+				print_usage();
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--frame-interval") == 0 && i + 1 < argc)
+		{
+			options.frame_interval = atoi(argv[++i]);
+			if (options.frame_interval < 1)
+			{
+				print_usage();
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--full-uploads") == 0)
+		{
+			options.tile_uploads = false;
+		}
+		else if (strcmp(argv[i], "--upload-budget") == 0 && i + 1 < argc)
+		{
+			options.upload_budget = atof(argv[++i]) * 1024 * 1024;
+		}
+		else if (strcmp(argv[i], "--upload-deadline") == 0 && i + 1 < argc)
+		{
+			options.upload_deadline_ms = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--compress-idle") == 0 && i + 1 < argc)
+		{
+			options.compress_idle_seconds = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-scroll") == 0)
+		{
+			options.scroll_detection = false;
+		}
+		else if (strcmp(argv[i], "--lock-memory") == 0)
+		{
+			options.lock_capture_memory = true;
+		}
+		else if (strcmp(argv[i], "--alloc-warmup") == 0 && i + 1 < argc)
+		{
+#ifdef SINPIN_ALLOC_COUNT
+			Allocs::warmup_frames = atoi(argv[++i]);
+#else
+			printf("--alloc-warmup only works in builds made with 'make alloccheck'\n");
+			i++;
+#endif
+		}
+		else
+		{
+			print_usage();
+			return 1;
+		}
+	}
+
 	signal(SIGINT, interrupted);
+	signal(SIGUSR1, write_trace);
+	signal(SIGUSR2, reset_profile);
 
-	auto app = App();
+	auto app = App(options);
+	if (record_path != nullptr && !app._input_log.StartRecording(&app, record_path))
+	{
+		return 1;
+	}
+	if (replay_path != nullptr && !app._input_log.StartReplay(&app, replay_path))
+	{
+		return 1;
+	}
+	if (latency_probe)
+	{
+		app._latency_probe.Start(&app);
+	}
 
-	while (!should_exit)
+	while (!should_exit && !app._input_log.ReplayFinished())
 	{
-		usleep(1000000 / UPDATE_RATE);
+		if (replay_path == nullptr)
+			usleep(1000000 / UPDATE_RATE);
+		else if (replay_speed > 0)
+			usleep(1000000 / UPDATE_RATE / replay_speed);
 		app.Update(1.0 / UPDATE_RATE);
+		if (should_write_trace)
+		{
+			should_write_trace = false;
+			Trace::Write();
+		}
+		if (should_reset_profile)
+		{
+			should_reset_profile = false;
+			Profiler::Reset();
+		}
 	}
 	printf("\nShutting down\n");
-	return 0;
+	bool allocs_ok = ALLOC_CHECK();
+	PROFILE_REPORT();
+	app._latency_probe.Report();
+	if (stats_path != nullptr)
+	{
+		Profiler::WriteJson(stats_path);
+	}
+	Trace::Write();
+	return allocs_ok ? 0 : 1;
 }
@@ -0,0 +1,67 @@
+#include "mapping.h"
+
+RectHit IntersectRect(glm::mat4x4 transform, float width, float height, glm::vec3 origin, glm::vec3 direction, float max_len)
+{
+	float dist = max_len;
+	auto ray_end_g = origin + direction * max_len;
+
+	auto panel_pos = GetPos(transform);
+	auto ray_start = glm::inverse(transform) * glm::vec4(origin - panel_pos, 0);
+	auto ray_end = glm::inverse(transform) * glm::vec4(ray_end_g - panel_pos, 0);
+	float length_frac = ray_start.z / (ray_start.z - ray_end.z);
+	auto hit_pos = ray_start + (ray_end - ray_start) * length_frac;
+
+	// clang-format off
+	if (ray_end.z < ray_start.z
+		&& ray_end.z < 0
+		&& glm::abs(hit_pos.x) < (width * 0.5f)
+		&& glm::abs(hit_pos.y) < (height * 0.5f)
+		&& length_frac > 0)
+	{
+		// clang-format on
+		dist = glm::min(length_frac * max_len, max_len);
+	}
+	return RectHit{dist, hit_pos};
+}
+
+glm::vec2 LaserToPixel(glm::vec3 local_pos, float overlay_width, float overlay_ratio, int panel_width)
+{
+	auto pos = glm::vec2(local_pos.x, local_pos.y);
+	// normalize positions to +-0.5
+	pos /= overlay_width;
+	pos.y *= -1;
+
+	// shift to 0-1
+	pos.x += 0.5f;
+	pos.y += 0.5f * overlay_ratio;
+
+	return pos * (float)panel_width;
+}
+
+VRMat LaserTransform(glm::mat4x4 controller_pose, glm::vec3 hmd_pos, float length, float laser_width)
+{
+	auto controller_pos = GetPos(controller_pose);
+	auto hmd_local_pos = glm::inverse(controller_pose) * glm::vec4(hmd_pos - controller_pos, 0);
+	hmd_local_pos.z = 0;
+	auto hmd_dir = glm::normalize(hmd_local_pos);
+
+	return VRMat{{{laser_width * hmd_dir.y, 0, laser_width * hmd_dir.x, 0}, {laser_width * -hmd_dir.x, 0, laser_width * hmd_dir.y, 0}, {0, length, 0, length * -0.5f}}};
+}
+
+vr::HmdVector2_t CursorOverridePosition(int local_x, int local_y, int width, int height)
+{
+	// TODO: make this work when aspect ratio is >1 (root window is taller than it is wide)
+	float ratio = (float)height / (float)width;
+	float top_edge = 0.5f - ratio / 2.0f;
+	float x = local_x / (float)width;
+	float y = 1.0f - (local_y / (float)width + top_edge);
+	return vr::HmdVector2_t{x, y};
+}
+
+VRMat CursorOverlayTransform(int local_x, int local_y, int width, int height, int image_width, int image_height, int hot_x, int hot_y, float meters_per_pixel)
+{
+	// the cursor overlay is centered on its transform, so offset it by the hotspot
+	float x = local_x - width * 0.5f + image_width * 0.5f - hot_x;
+	float y = height * 0.5f - local_y - image_height * 0.5f + hot_y;
+	return VRMat{{{1, 0, 0, x * meters_per_pixel}, {0, 1, 0, y * meters_per_pixel}, {0, 0, 1, 0.001f}}};
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "util.h"
+
+// The geometry behind lasers and cursors, without any OpenVR or X calls so bench/micro.cpp can time it.
+
+struct RectHit
+{
+	float distance; // max_len if the ray misses
+	glm::vec3 local_pos;
+};
+
+// ray against a rectangle centered on transform's origin, facing its +z axis
+RectHit IntersectRect(glm::mat4x4 transform, float width, float height, glm::vec3 origin, glm::vec3 direction, float max_len);
+
+// position on an overlay (meters from its center) to panel pixels
+glm::vec2 LaserToPixel(glm::vec3 local_pos, float overlay_width, float overlay_ratio, int panel_width);
+
+// laser overlay transform relative to the controller, rotated around the laser to face the hmd
+VRMat LaserTransform(glm::mat4x4 controller_pose, glm::vec3 hmd_pos, float length, float laser_width);
+
+// SteamVR cursor override position (0-1, from the bottom left) for a pixel on a panel
+vr::HmdVector2_t CursorOverridePosition(int local_x, int local_y, int width, int height);
+
+// cursor overlay transform relative to its panel, placing the cursor image hotspot on the pixel
+VRMat CursorOverlayTransform(int local_x, int local_y, int width, int height, int image_width, int image_height, int hot_x, int hot_y, float meters_per_pixel);
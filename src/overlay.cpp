@@ -1,5 +1,7 @@
 #include "overlay.h"
 #include "app.h"
+#include "mapping.h"
+#include "trace.h"
 #include "util.h"
 #include <cstdint>
 
@@ -8,10 +10,10 @@ Overlay::Overlay()
 	_initialized = false;
 }
 
-Overlay::Overlay(App *app, std::string name)
+Overlay::Overlay(App *app, const char *name)
 {
 	_initialized = true;
-	_name = name;
+	snprintf(_name, sizeof(_name), "%s", name);
 	_app = app;
 	_holding_controller = nullptr;
 	_resize_controller = nullptr;
@@ -21,14 +23,14 @@ Overlay::Overlay(App *app, std::string name)
 
 	_target = Target{.type = TargetType::World, .transform = VRMatIdentity};
 
-	auto overlay_create_err = _app->vr_overlay->CreateOverlay(_name.c_str(), _name.c_str(), &_id);
+	auto overlay_create_err = TRACE_CALL("IVROverlay::CreateOverlay", _app->vr_overlay->CreateOverlay(_name, _name, &_id));
 	assert(overlay_create_err == 0);
 
 	// (flipping uv on y axis because opengl and xorg are opposite)
 	vr::VRTextureBounds_t bounds{0, 1, 1, 0};
-	_app->vr_overlay->SetOverlayTextureBounds(_id, &bounds);
-	_app->vr_overlay->ShowOverlay(_id);
-	printf("Created overlay instance %s\n", _name.c_str());
+	TRACE_CALL("IVROverlay::SetOverlayTextureBounds", _app->vr_overlay->SetOverlayTextureBounds(_id, &bounds));
+	TRACE_CALL("IVROverlay::ShowOverlay", _app->vr_overlay->ShowOverlay(_id));
+	printf("Created overlay instance %s\n", _name);
 }
 
 OverlayID Overlay::Id()
@@ -69,7 +71,7 @@ float Overlay::Ratio()
 void Overlay::SetWidth(float width_meters)
 {
 	_width_m = width_meters;
-	_app->vr_overlay->SetOverlayWidthInMeters(_id, _width_m);
+	TRACE_CALL("IVROverlay::SetOverlayWidthInMeters", _app->vr_overlay->SetOverlayWidthInMeters(_id, _width_m));
 }
 
 void Overlay::SetHidden(bool state)
@@ -78,16 +80,16 @@ void Overlay::SetHidden(bool state)
 	{
 		_hidden = state;
 		if (_hidden)
-			_app->vr_overlay->HideOverlay(_id);
+			TRACE_CALL("IVROverlay::HideOverlay", _app->vr_overlay->HideOverlay(_id));
 		else
-			_app->vr_overlay->ShowOverlay(_id);
+			TRACE_CALL("IVROverlay::ShowOverlay", _app->vr_overlay->ShowOverlay(_id));
 	}
 }
 
 void Overlay::SetAlpha(float alpha)
 {
 	_alpha = alpha;
-	_app->vr_overlay->SetOverlayAlpha(_id, alpha);
+	TRACE_CALL("IVROverlay::SetOverlayAlpha", _app->vr_overlay->SetOverlayAlpha(_id, alpha));
 }
 
 void Overlay::SetRatio(float ratio)
@@ -97,20 +99,20 @@ void Overlay::SetRatio(float ratio)
 
 void Overlay::SetTexture(vr::Texture_t *texture)
 {
-	auto set_texture_err = _app->vr_overlay->SetOverlayTexture(_id, texture);
+	auto set_texture_err = TRACE_CALL("IVROverlay::SetOverlayTexture", _app->vr_overlay->SetOverlayTexture(_id, texture));
 	assert(set_texture_err == 0);
 }
 
 void Overlay::SetTextureToColor(uint8_t r, uint8_t g, uint8_t b)
 {
 	uint8_t col[4] = {r, g, b, 255};
-	auto set_texture_err = _app->vr_overlay->SetOverlayRaw(_id, &col, 1, 1, 4);
+	auto set_texture_err = TRACE_CALL("IVROverlay::SetOverlayRaw", _app->vr_overlay->SetOverlayRaw(_id, &col, 1, 1, 4));
 	assert(set_texture_err == 0);
 }
 
 void Overlay::SetColor(float r, float g, float b)
 {
-	auto set_color_err = _app->vr_overlay->SetOverlayColor(_id, r, g, b);
+	auto set_color_err = TRACE_CALL("IVROverlay::SetOverlayColor", _app->vr_overlay->SetOverlayColor(_id, r, g, b));
 	assert(set_color_err == 0);
 }
 
@@ -122,7 +124,7 @@ void Overlay::SetColor(Color c)
 void Overlay::SetTransformTracker(TrackerID tracker, const VRMat *transform)
 {
 	auto original_pose = _target.transform;
-	_app->vr_overlay->SetOverlayTransformTrackedDeviceRelative(_id, tracker, transform);
+	TRACE_CALL("IVROverlay::SetOverlayTransformTrackedDeviceRelative", _app->vr_overlay->SetOverlayTransformTrackedDeviceRelative(_id, tracker, transform));
 	_target.type = TargetType::Tracker;
 	_target.id = tracker;
 	_target.transform = *transform;
@@ -140,11 +142,18 @@ void Overlay::SetTransformTracker(TrackerID tracker, const VRMat *transform)
 
 void Overlay::SetTransformWorld(const VRMat *transform)
 {
-	_app->vr_overlay->SetOverlayTransformAbsolute(_id, vr::TrackingUniverseStanding, transform);
+	TRACE_CALL("IVROverlay::SetOverlayTransformAbsolute", _app->vr_overlay->SetOverlayTransformAbsolute(_id, vr::TrackingUniverseStanding, transform));
 	_target.type = TargetType::World;
 	_target.transform = *transform;
 }
 
+// follows the parent overlay around, so it is not affected by grabbing or resetting
+void Overlay::SetTransformOverlay(Overlay *parent, const VRMat *transform)
+{
+	TRACE_CALL("IVROverlay::SetOverlayTransformOverlayRelative", _app->vr_overlay->SetOverlayTransformOverlayRelative(_id, parent->Id(), transform));
+	_target.transform = *transform;
+}
+
 void Overlay::SetTargetTracker(TrackerID tracker)
 {
 	auto abs_mat = GetTransformAbsolute();
@@ -161,27 +170,8 @@ void Overlay::SetTargetWorld()
 
 Ray Overlay::IntersectRay(glm::vec3 ray_start_g, glm::vec3 direction, float max_len)
 {
-	float dist = max_len;
-	auto ray_end_g = ray_start_g + direction * max_len;
-
-	auto panel_transform = GetTransformAbsolute();
-	auto panel_pos = GetPos(panel_transform);
-	auto ray_start = glm::inverse(panel_transform) * glm::vec4(ray_start_g - panel_pos, 0);
-	auto ray_end = glm::inverse(panel_transform) * glm::vec4(ray_end_g - panel_pos, 0);
-	float length_frac = ray_start.z / (ray_start.z - ray_end.z);
-	auto hit_pos = ray_start + (ray_end - ray_start) * length_frac;
-
-	// clang-format off
-	if (ray_end.z < ray_start.z
-		&& ray_end.z < 0
-		&& glm::abs(hit_pos.x) < (_width_m * 0.5f)
-		&& glm::abs(hit_pos.y) < (_width_m * 0.5f * _ratio)
-		&& length_frac > 0)
-	{
-		// clang-format on
-		dist = glm::min(length_frac * max_len, max_len);
-	}
-	return Ray{.overlay = this, .distance = dist, .local_pos = hit_pos, .hit_panel = nullptr};
+	auto hit = IntersectRect(GetTransformAbsolute(), _width_m, _width_m * _ratio, ray_start_g, direction, max_len);
+	return Ray{.overlay = this, .distance = hit.distance, .local_pos = hit.local_pos, .hit_panel = nullptr};
 }
 
 glm::mat4x4 Overlay::GetTransformAbsolute()
@@ -190,18 +180,18 @@ glm::mat4x4 Overlay::GetTransformAbsolute()
 	{
 		VRMat pose;
 		vr::ETrackingUniverseOrigin tracking_universe;
-		_app->vr_overlay->GetOverlayTransformAbsolute(_id, &tracking_universe, &pose);
+		TRACE_CALL("IVROverlay::GetOverlayTransformAbsolute", _app->vr_overlay->GetOverlayTransformAbsolute(_id, &tracking_universe, &pose));
 		return ConvertMat(pose);
 	}
 	if (_target.type == TargetType::Tracker)
 	{
 		VRMat pose;
-		_app->vr_overlay->GetOverlayTransformTrackedDeviceRelative(_id, &_target.id, &pose);
+		TRACE_CALL("IVROverlay::GetOverlayTransformTrackedDeviceRelative", _app->vr_overlay->GetOverlayTransformTrackedDeviceRelative(_id, &_target.id, &pose));
 		auto offset = ConvertMat(pose);
 		auto tracker_pose = _app->GetTrackerPose(_target.id);
 		return tracker_pose * offset;
 	}
-	printf("Error: overlay '%s' not set to a valid target", _name.c_str());
+	printf("Error: overlay '%s' not set to a valid target", _name);
 	return ConvertMat(VRMatIdentity);
 }
 
@@ -214,7 +204,7 @@ void Overlay::Update()
 {
 	if (!_initialized)
 	{
-		printf("Error: overlay %s is not initialized.\n", _name.c_str());
+		printf("Error: overlay %s is not initialized.\n", _name);
 		assert(_initialized);
 	}
 
@@ -263,7 +253,7 @@ void Overlay::Update()
 
 void Overlay::ControllerGrab(Controller *controller)
 {
-	_app->vr_overlay->SetOverlayColor(_id, 0.6f, 0.8f, 0.8f);
+	TRACE_CALL("IVROverlay::SetOverlayColor", _app->vr_overlay->SetOverlayColor(_id, 0.6f, 0.8f, 0.8f));
 	SetTargetTracker(controller->DeviceIndex());
 
 	for (auto child : _children)
@@ -282,7 +272,7 @@ void Overlay::ControllerRelease()
 	{
 		_holding_controller->ReleaseOverlay();
 	}
-	_app->vr_overlay->SetOverlayColor(_id, 1.0f, 1.0f, 1.0f);
+	TRACE_CALL("IVROverlay::SetOverlayColor", _app->vr_overlay->SetOverlayColor(_id, 1.0f, 1.0f, 1.0f));
 
 	SetTargetWorld();
 	for (auto child : _children)
@@ -2,7 +2,6 @@
 
 #include "util.h"
 #include <functional>
-#include <string>
 #include <vector>
 
 class App;
@@ -26,7 +25,7 @@ class Overlay
 {
   public:
 	Overlay();
-	Overlay(App *app, std::string name);
+	Overlay(App *app, const char *name);
 	void Update();
 
 	OverlayID Id();
@@ -51,6 +50,7 @@ class Overlay
 
 	void SetTransformTracker(TrackerID tracker, const VRMat *transform);
 	void SetTransformWorld(const VRMat *transform);
+	void SetTransformOverlay(Overlay *parent, const VRMat *transform);
 
 	void SetTargetTracker(TrackerID tracker);
 	void SetTargetWorld();
@@ -70,7 +70,8 @@ class Overlay
 	App *_app;
 	OverlayID _id;
 
-	std::string _name;
+	// inline so copying an overlay around never allocates
+	char _name[vr::k_unVROverlayMaxKeyLength];
 	bool _hidden;
 	float _width_m;
 	float _alpha;
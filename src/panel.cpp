@@ -1,6 +1,15 @@
 #include "panel.h"
+#include "allocs.h"
 #include "app.h"
+#include "mapping.h"
 #include "overlay.h"
+#include "probes.h"
+#include "profiler.h"
+#include "trace.h"
+#include <string>
+
+// how far away a panel can be for the HMD view to prioritize its uploads
+const float FOCUS_VIEW_DISTANCE = 8.0f;
 
 Panel::Panel(App *app, int index, int x, int y, int width, int height)
 	: _app(app),
@@ -9,7 +18,8 @@ Panel::Panel(App *app, int index, int x, int y, int width, int height)
 	  _y(y),
 	  _width(width),
 	  _height(height),
-	  _overlay(app, "screen_view_" + std::to_string(index))
+	  _overlay(app, ("screen_view_" + std::to_string(index)).c_str()),
+	  _cursor_overlay(app, ("screen_cursor_" + std::to_string(index)).c_str())
 {
 	glGenTextures(1, &_gl_texture);
 	glBindTexture(GL_TEXTURE_2D, _gl_texture);
@@ -22,9 +32,29 @@ Panel::Panel(App *app, int index, int x, int y, int width, int height)
 	_texture.eColorSpace = vr::ColorSpace_Auto;
 	_texture.eType = vr::TextureType_OpenGL;
 	_texture.handle = (void *)(uintptr_t)_gl_texture;
+	_changes.Init(width, height, _app->_options.scroll_detection && _app->_copy_image_supported);
+	if (_app->_pixel_format != PixelFormat::BGRX)
+	{
+		_converted.resize((size_t)width * height * 4);
+	}
 	_overlay.SetRatio(height / (float)width);
 	_overlay.SetTextureToColor(50, 20, 50);
 	ResetTransform();
+
+	_cursor_texture = _texture;
+	_cursor_texture.handle = (void *)(uintptr_t)_app->_gl_cursor;
+	_app->vr_overlay->SetOverlaySortOrder(_cursor_overlay.Id(), 1);
+	_app->vr_overlay->SetOverlayFlag(_cursor_overlay.Id(), vr::VROverlayFlags_IsPremultiplied, true);
+	_cursor_overlay.SetHidden(true);
+}
+
+void Panel::Destroy()
+{
+	ReleaseUpload();
+	glDeleteTextures(1, &_gl_texture);
+	glDeleteTextures(1, &_scroll_texture);
+	glDeleteTextures(1, &_compressed_texture);
+	_gl_texture = _scroll_texture = _compressed_texture = 0;
 }
 
 void Panel::ResetTransform()
@@ -38,9 +68,61 @@ void Panel::ResetTransform()
 	_overlay.SetWidth(width);
 }
 
+void Panel::RequestCapture()
+{
+	TRACE_PANEL(_index);
+	if (_texture_state == PanelTexture::Encoding)
+	{
+		// the encoder still reads the last capture
+		return;
+	}
+	if (_capture_pending)
+	{
+		// previous capture was never rendered (eg. overlays got hidden), drop its reply
+		// and keep its buffer, the X server writes the new capture into it after the old one
+		if (_capture_buffer != nullptr)
+			xcb_discard_reply(_app->_xcb, _shm_cookie.sequence);
+		else
+			xcb_discard_reply(_app->_xcb, _image_cookie.sequence);
+		_capture_pending = false;
+	}
+	if (_app->_capture_pool.IsReady())
+	{
+		if (_capture_buffer == nullptr)
+		{
+			_capture_buffer = _app->_capture_pool.Acquire();
+		}
+		if (_capture_buffer == nullptr)
+		{
+			// every buffer is still in use, this panel skips a capture
+			return;
+		}
+		TRACE_SCOPE("xcb_shm_get_image");
+		_shm_cookie = xcb_shm_get_image(
+			_app->_xcb, _app->_root_window,
+			_x, _y, _width, _height,
+			~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+			_app->_capture_pool.Segment(), _capture_buffer->offset);
+	}
+	else
+	{
+		TRACE_SCOPE("xcb_get_image");
+		_image_cookie = xcb_get_image(
+			_app->_xcb, XCB_IMAGE_FORMAT_Z_PIXMAP, _app->_root_window,
+			_x, _y, _width, _height, ~0);
+	}
+	_capture_pending = true;
+	_capture_time = ClockNanoseconds(CLOCK_MONOTONIC);
+	PROBE2(capture_begin, _index, _width * _height * 4);
+}
+
 void Panel::Update()
 {
-	Render();
+	TRACE_PANEL(_index);
+	if (_capture_pending)
+	{
+		Render();
+	}
 	UpdateCursor();
 
 	_overlay.Update();
@@ -53,19 +135,400 @@ Overlay *Panel::GetOverlay()
 
 void Panel::Render()
 {
-	glCopyImageSubData(
-		_app->_gl_frame, GL_TEXTURE_2D, 0,
-		_x, _y, 0,
-		_gl_texture, GL_TEXTURE_2D, 0,
-		0, 0, 0,
-		_width, _height, 1);
+	PROFILE_STAGE(Stage::Render);
+	TRACE_SCOPE("Panel::Render");
+	_capture_pending = false;
+	const uint8_t *pixels;
+	xcb_get_image_reply_t *image_reply = nullptr;
+	if (_capture_buffer != nullptr)
+	{
+		PROFILE_STAGE(Stage::CaptureWait);
+		auto shm_reply = TRACE_CALL("xcb_shm_get_image_reply", ALLOC_EXPECTED(xcb_shm_get_image_reply(_app->_xcb, _shm_cookie, nullptr)));
+		if (shm_reply == nullptr)
+		{
+			printf("Error capturing screen %d\n", _index);
+			_app->_capture_pool.Release(_capture_buffer);
+			_capture_buffer = nullptr;
+			return;
+		}
+		free(shm_reply);
+		pixels = _capture_buffer->data;
+	}
+	else
+	{
+		PROFILE_STAGE(Stage::CaptureWait);
+		image_reply = TRACE_CALL("xcb_get_image_reply", ALLOC_EXPECTED(xcb_get_image_reply(_app->_xcb, _image_cookie, nullptr)));
+		if (image_reply == nullptr)
+		{
+			printf("Error capturing screen %d\n", _index);
+			return;
+		}
+		pixels = xcb_get_image_data(image_reply);
+	}
+
+	// tiles still pending from the previous capture are uploaded from this one instead
+	ReleaseUpload();
+	if (!_converted.empty())
+	{
+		// everything after this reads the BGRX copy, as if it had been captured to client memory
+		// the capture buffer stays with this panel for its next capture
+		pixels = ConvertCapture(pixels);
+		free(image_reply);
+		image_reply = nullptr;
+	}
+	else if (_capture_buffer != nullptr)
+	{
+		_app->_capture_pool.StartUpload(_capture_buffer);
+		_upload_buffer = _capture_buffer;
+		_capture_buffer = nullptr;
+	}
+	_upload_reply = image_reply;
+	_upload_pixels = pixels;
+	_upload_capture_time = _capture_time;
+	_upload_bytes = 0;
 
-	_overlay.SetTexture(&_texture);
+	if (_app->_latency_probe.IsEnabled())
+	{
+		_app->_latency_probe.OnCapture(_index, _x, _y, _width, _height, pixels);
+	}
+	PROFILE_CAPTURED_BYTES(_width * _height * 4);
+
+	if (!_app->_options.tile_uploads)
+	{
+		_full_upload = true;
+		PROFILE_TILES(_changes.TileCount(), _changes.TileCount());
+		return;
+	}
+	[[maybe_unused]] int changed_tiles; // only counted with SINPIN_PROFILE
+	{
+		PROFILE_STAGE(Stage::TileHash);
+		TRACE_SCOPE("ChangeDetector::Update");
+		changed_tiles = _changes.Update(pixels, _capture_time);
+	}
+	PROFILE_TILES(changed_tiles, _changes.TileCount());
+	if (_changes.Shifts().empty() && !_changes.HasPending())
+	{
+		// the texture already shows this, and so does SteamVR
+		if (!StartCompression())
+			ReleaseUpload();
+		PROBE2(capture_end, _index, 0);
+		return;
+	}
+	_last_change_time = _capture_time;
+	if (_texture_state == PanelTexture::Compressed)
+	{
+		ShowRaw();
+		return;
+	}
+	if (!_changes.Shifts().empty())
+	{
+		// the rows exposed by a scroll are wrong in the texture until they are uploaded, so they go right away
+		PROFILE_STAGE(Stage::Upload);
+		ApplyShifts();
+		size_t uploaded_bytes = UploadRuns();
+		_app->_upload_budget -= std::min(uploaded_bytes, _app->_upload_budget);
+		PROFILE_UPLOADED_BYTES(uploaded_bytes);
+		_upload_bytes += uploaded_bytes;
+		_texture_changed = true;
+	}
+}
+
+void Panel::UploadPending()
+{
+	if (_upload_pixels == nullptr)
+	{
+		return;
+	}
+	TRACE_PANEL(_index);
+	if (_texture_state == PanelTexture::Encoding)
+	{
+		FinishCompression();
+		return;
+	}
+	size_t uploaded_bytes = 0;
+	{
+		PROFILE_STAGE(Stage::Upload);
+		TRACE_SCOPE("Panel::UploadPending");
+		int picked = _changes.TileCount();
+		if (!_full_upload)
+		{
+			uint64_t deadline = _app->_options.upload_deadline_ms * 1000000ull;
+			picked = _changes.Schedule(&_app->_upload_budget, _focus.x, _focus.y, ClockNanoseconds(CLOCK_MONOTONIC), deadline);
+		}
+		else
+		{
+			_app->_upload_budget -= std::min((size_t)_width * _height * 4, _app->_upload_budget);
+		}
+		_full_upload = false;
+		if (picked == _changes.TileCount())
+		{
+			BindUploadSource();
+			glTexSubImage2D(
+				GL_TEXTURE_2D, 0,
+				0, 0, _width, _height,
+				GL_BGRA, GL_UNSIGNED_BYTE, UploadSource(0, 0));
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			uploaded_bytes = _width * _height * 4;
+		}
+		else if (picked > 0)
+		{
+			uploaded_bytes = UploadRuns();
+		}
+	}
+	PROFILE_UPLOADED_BYTES(uploaded_bytes);
+	_upload_bytes += uploaded_bytes;
+	if (uploaded_bytes > 0)
+	{
+		_texture_changed = true;
+	}
+	bool finished = !_changes.HasPending();
+	if (finished)
+	{
+		if (_app->_latency_probe.IsEnabled())
+		{
+			_app->_latency_probe.OnUpload(_index, _gl_texture);
+		}
+		PROBE2(capture_end, _index, _upload_bytes);
+	}
+
+	if (_texture_changed)
+	{
+		_texture_changed = false;
+		PROBE1(texture_submit_begin, _index);
+		{
+			PROFILE_STAGE(Stage::Submit);
+			_overlay.SetTexture(&_texture);
+		}
+		PROBE1(texture_submit_end, _index);
+	}
+	if (finished)
+	{
+		if (_app->_latency_probe.IsEnabled())
+		{
+			_app->_latency_probe.OnSubmit(_index);
+		}
+		PROFILE_RECORD(Stage::CaptureLatency, ClockNanoseconds(CLOCK_MONOTONIC) - _upload_capture_time);
+		ReleaseUpload();
+	}
+}
+
+const uint8_t *Panel::ConvertCapture(const uint8_t *pixels)
+{
+	PROFILE_STAGE(Stage::Convert);
+	TRACE_SCOPE("ConvertToBgrx");
+	size_t stride = ZPixmapStride(_app->_pixel_format, _width, _app->_scanline_pad);
+	ConvertToBgrx(_app->_pixel_format, pixels, stride, _converted.data(), _width, _height);
+	return _converted.data();
+}
+
+void Panel::BindUploadSource()
+{
+	glBindTexture(GL_TEXTURE_2D, _gl_texture);
+	if (_upload_buffer != nullptr && _app->_capture_pool.IsPinned())
+	{
+		// the GPU reads straight from the memory the X server wrote into
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _app->_capture_pool.UploadBuffer());
+	}
+}
+
+const uint8_t *Panel::UploadSource(int x, int y)
+{
+	size_t offset = ((size_t)y * _width + x) * 4;
+	if (_upload_buffer != nullptr && _app->_capture_pool.IsPinned())
+	{
+		// an offset into the bound unpack buffer
+		return (const uint8_t *)(uintptr_t)(_upload_buffer->offset + offset);
+	}
+	return _upload_pixels + offset;
+}
+
+size_t Panel::UploadRuns()
+{
+	TRACE_SCOPE("glTexSubImage2D");
+	BindUploadSource();
+	size_t uploaded_bytes = 0;
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, _width);
+	for (auto &run : _changes.Runs())
+	{
+		glTexSubImage2D(
+			GL_TEXTURE_2D, 0,
+			run.x, run.y, run.width, run.height,
+			GL_BGRA, GL_UNSIGNED_BYTE, UploadSource(run.x, run.y));
+		uploaded_bytes += run.width * run.height * 4;
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return uploaded_bytes;
+}
+
+void Panel::ReleaseUpload()
+{
+	if (_upload_buffer != nullptr)
+	{
+		// with pinned memory the buffer stays in use until the GPU has read it
+		_app->_capture_pool.FinishUpload(_upload_buffer);
+		_upload_buffer = nullptr;
+	}
+	free(_upload_reply);
+	_upload_reply = nullptr;
+	_upload_pixels = nullptr;
+}
+
+bool Panel::StartCompression()
+{
+	uint64_t idle_ns = _app->_options.compress_idle_seconds * 1e9;
+	if (_texture_state != PanelTexture::Raw || !_app->_bc1_encoder.IsReady() || _capture_time - _last_change_time < idle_ns)
+	{
+		return false;
+	}
+	// keeps the capture until it is encoded, the encoder is shared by all panels and may be busy
+	if (!_app->_bc1_encoder.Start(_upload_pixels, _width, _height))
+	{
+		return false;
+	}
+	_texture_state = PanelTexture::Encoding;
+	return true;
+}
+
+void Panel::FinishCompression()
+{
+	auto encoder = &_app->_bc1_encoder;
+	if (!encoder->IsDone())
+	{
+		return;
+	}
+	TRACE_SCOPE("Panel::FinishCompression");
+	{
+		PROFILE_STAGE(Stage::Upload);
+		if (_compressed_texture == 0)
+		{
+			glGenTextures(1, &_compressed_texture);
+			glBindTexture(GL_TEXTURE_2D, _compressed_texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		}
+		glBindTexture(GL_TEXTURE_2D, _compressed_texture);
+		glCompressedTexImage2D(
+			GL_TEXTURE_2D, 0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+			_width, _height, 0,
+			encoder->Size(), encoder->Data());
+		PROFILE_UPLOADED_BYTES(encoder->Size());
+		encoder->Release();
+		_texture.handle = (void *)(uintptr_t)_compressed_texture;
+	}
+	{
+		PROFILE_STAGE(Stage::Submit);
+		_overlay.SetTexture(&_texture);
+	}
+	// the raw texture and the scroll scratch space are not needed until the panel changes again
+	glBindTexture(GL_TEXTURE_2D, _gl_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 0, 0, 0, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+	if (_scroll_texture != 0)
+	{
+		glDeleteTextures(1, &_scroll_texture);
+		_scroll_texture = 0;
+	}
+	ReleaseUpload();
+	_texture_state = PanelTexture::Compressed;
+}
+
+void Panel::ShowRaw()
+{
+	// the raw texture holds nothing, so it gets the whole capture at once
+	TRACE_SCOPE("Panel::ShowRaw");
+	PROFILE_STAGE(Stage::Upload);
+	BindUploadSource();
+	glTexImage2D(
+		GL_TEXTURE_2D, 0, GL_RGB,
+		_width, _height, 0,
+		GL_BGRA, GL_UNSIGNED_BYTE, UploadSource(0, 0));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	_changes.MarkUploaded();
+	size_t uploaded_bytes = _width * _height * 4;
+	_app->_upload_budget -= std::min(uploaded_bytes, _app->_upload_budget);
+	PROFILE_UPLOADED_BYTES(uploaded_bytes);
+	_upload_bytes += uploaded_bytes;
+	_texture.handle = (void *)(uintptr_t)_gl_texture;
+	_texture_changed = true;
+	glDeleteTextures(1, &_compressed_texture);
+	_compressed_texture = 0;
+	_texture_state = PanelTexture::Raw;
+}
+
+void Panel::UpdateFocus()
+{
+	// the laser pointing at this panel, otherwise where the HMD looks at it
+	for (auto &controller : _app->_controllers)
+	{
+		if (!controller.has_value())
+			continue;
+		auto ray = controller->GetLastRay();
+		if (ray.hit_panel == this && ray.overlay != nullptr)
+		{
+			auto pos = LaserToPixel(ray.local_pos, ray.overlay->Width(), ray.overlay->Ratio(), _width);
+			_focus = CursorPos{(int)pos.x, (int)pos.y};
+			_focus_rank = UploadFocus::Laser;
+			return;
+		}
+	}
+	_focus = CursorPos{-1, -1};
+	_focus_rank = UploadFocus::Anywhere;
+	if (_upload_pixels == nullptr)
+	{
+		return;
+	}
+	auto hmd_pose = _app->GetTrackerPose(vr::k_unTrackedDeviceIndex_Hmd);
+	auto ray = _overlay.IntersectRay(GetPos(hmd_pose), -glm::vec3(hmd_pose[2]), FOCUS_VIEW_DISTANCE);
+	if (ray.distance < FOCUS_VIEW_DISTANCE)
+	{
+		auto pos = LaserToPixel(ray.local_pos, _overlay.Width(), _overlay.Ratio(), _width);
+		_focus = CursorPos{(int)pos.x, (int)pos.y};
+		_focus_rank = UploadFocus::View;
+	}
+}
+
+UploadFocus Panel::FocusRank()
+{
+	return _focus_rank;
+}
+
+void Panel::ApplyShifts()
+{
+	if (_changes.Shifts().empty())
+	{
+		return;
+	}
+	TRACE_SCOPE("Panel::ApplyShifts");
+	if (_scroll_texture == 0)
+	{
+		glGenTextures(1, &_scroll_texture);
+		glBindTexture(GL_TEXTURE_2D, _scroll_texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexImage2D(
+			GL_TEXTURE_2D, 0, GL_RGB,
+			_width, _height, 0,
+			GL_BGRA, GL_UNSIGNED_BYTE, 0);
+		glBindTexture(GL_TEXTURE_2D, _gl_texture);
+	}
+	for (auto &shift : _changes.Shifts())
+	{
+		// source and destination overlap, which glCopyImageSubData does not allow within one texture
+		glCopyImageSubData(
+			_gl_texture, GL_TEXTURE_2D, 0, shift.x, shift.src_y, 0,
+			_scroll_texture, GL_TEXTURE_2D, 0, shift.x, shift.src_y, 0,
+			shift.width, shift.height, 1);
+		glCopyImageSubData(
+			_scroll_texture, GL_TEXTURE_2D, 0, shift.x, shift.src_y, 0,
+			_gl_texture, GL_TEXTURE_2D, 0, shift.x, shift.dst_y, 0,
+			shift.width, shift.height, 1);
+		PROFILE_SCROLL(shift.width * shift.height * 4);
+	}
 }
 
 void Panel::SetHidden(bool state)
 {
 	_overlay.SetHidden(state);
+	if (state)
+		_cursor_overlay.SetHidden(true);
 }
 
 Ray Panel::IntersectRay(glm::vec3 origin, glm::vec3 direction, float max_len)
@@ -82,20 +545,53 @@ void Panel::SetCursor(int x, int y)
 
 void Panel::UpdateCursor()
 {
+	PROFILE_STAGE(Stage::Cursor);
+	TRACE_SCOPE("Panel::UpdateCursor");
 	auto global_pos = _app->GetCursorPosition();
-	if (global_pos.x < _x || global_pos.x >= _x + _width || global_pos.y < _y || global_pos.y >= _y + _height)
+	bool outside = global_pos.x < _x || global_pos.x >= _x + _width || global_pos.y < _y || global_pos.y >= _y + _height;
+	if (_app->_gl_cursor != 0)
+	{
+		bool visible = !outside && _app->_cursor_image.width > 0;
+		_cursor_overlay.SetHidden(!visible);
+		if (visible)
+		{
+			UpdateCursorOverlay(global_pos.x - _x, global_pos.y - _y);
+		}
+		return;
+	}
+	if (outside)
+	{
+		TRACE_CALL("IVROverlay::ClearOverlayCursorPositionOverride", _app->vr_overlay->ClearOverlayCursorPositionOverride(_overlay.Id()));
+		return;
+	}
+	auto pos = CursorOverridePosition(global_pos.x - _x, global_pos.y - _y, _width, _height);
+	TRACE_CALL("IVROverlay::SetOverlayCursorPositionOverride", _app->vr_overlay->SetOverlayCursorPositionOverride(_overlay.Id(), &pos));
+}
+
+void Panel::UpdateCursorOverlay(int local_x, int local_y)
+{
+	auto image = _app->_cursor_image;
+	float meters_per_pixel = _overlay.Width() / _width;
+	if (image.serial != _cursor_serial)
+	{
+		_cursor_serial = image.serial;
+		_cursor_overlay.SetTexture(&_cursor_texture);
+		_cursor_last_width = 0;
+		_cursor_last_pos = {-1, -1};
+	}
+	float width = image.width * meters_per_pixel;
+	if (width != _cursor_last_width)
+	{
+		_cursor_last_width = width;
+		_cursor_overlay.SetWidth(width);
+		_cursor_last_pos = {-1, -1};
+	}
+	if (local_x == _cursor_last_pos.x && local_y == _cursor_last_pos.y)
 	{
-		_app->vr_overlay->ClearOverlayCursorPositionOverride(_overlay.Id());
 		return;
 	}
-	int local_x = global_pos.x - _x;
-	int local_y = global_pos.y - _y;
+	_cursor_last_pos = {local_x, local_y};
 
-	// TODO: make this work when aspect ratio is >1 (root window is taller than it is wide)
-	float ratio = (float)_height / (float)_width;
-	float top_edge = 0.5f - ratio / 2.0f;
-	float x = local_x / (float)_width;
-	float y = 1.0f - (local_y / (float)_width + top_edge);
-	auto pos = vr::HmdVector2_t{x, y};
-	_app->vr_overlay->SetOverlayCursorPositionOverride(_overlay.Id(), &pos);
+	VRMat transform = CursorOverlayTransform(local_x, local_y, _width, _height, image.width, image.height, image.hot_x, image.hot_y, meters_per_pixel);
+	_cursor_overlay.SetTransformOverlay(&_overlay, &transform);
 }
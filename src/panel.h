@@ -1,23 +1,51 @@
 #pragma once
+#include "capturepool.h"
+#include "changes.h"
 #include "overlay.h"
 #define GL_GLEXT_PROTOTYPES
 
 #include "util.h"
 #include <GLFW/glfw3.h>
+#include <xcb/shm.h>
+#include <xcb/xcb.h>
 
 const VRMat DEFAULT_POSE = {{{1, 0, 0, 0}, {0, 1, 0, 1}, {0, 0, 1, 0}}};
 
 class App;
 class Overlay;
 
+// which texture a panel shows
+enum class PanelTexture
+{
+	Raw,
+	Encoding,   // still raw, the last capture is being encoded to BC1 after the panel went idle
+	Compressed, // BC1, until the panel changes again
+};
+
+// what decides the order a panel's pending tiles are uploaded in, panels upload in this order too
+enum class UploadFocus
+{
+	Laser,    // nearest to where a laser points first
+	View,     // nearest to where the HMD looks first
+	Anywhere, // top to bottom
+};
+
 class Panel
 {
   public:
-	Panel(App *app, int index, int xmin, int xmax, int ymin, int ymax);
+	Panel(App *app, int index, int x, int y, int width, int height);
 
+	void RequestCapture();
 	void Update();
+	// finds what the uploads should start with, before UploadPending
+	void UpdateFocus();
+	UploadFocus FocusRank();
+	// uploads the pending tiles of the last capture that fit in the frame's upload budget
+	void UploadPending();
 	void SetHidden(bool state);
 	void ResetTransform();
+	// frees the textures and the capture being uploaded, while the GL context still exists
+	void Destroy();
 
 	int Width()
 	{
@@ -36,7 +64,20 @@ class Panel
 
   private:
 	void Render();
+	// moves scrolled content within the texture, before the rest of the capture is uploaded
+	void ApplyShifts();
+	// fills _converted with the BGRX version of a 16 or 30 bit capture
+	const uint8_t *ConvertCapture(const uint8_t *pixels);
+	void BindUploadSource();
+	// pointer or pinned buffer offset of a pixel in the capture being uploaded
+	const uint8_t *UploadSource(int x, int y);
+	size_t UploadRuns();
+	void ReleaseUpload();
+	bool StartCompression();
+	void FinishCompression();
+	void ShowRaw();
 	void UpdateCursor();
+	void UpdateCursorOverlay(int local_x, int local_y);
 
 	App *_app;
 	int _index;
@@ -45,7 +86,36 @@ class Panel
 	int _width, _height;
 
 	Overlay _overlay;
+	Overlay _cursor_overlay;
 
 	vr::Texture_t _texture;
 	GLuint _gl_texture;
+	GLuint _scroll_texture = 0; // scratch space for ApplyShifts, created on the first scroll
+	GLuint _compressed_texture = 0;
+	PanelTexture _texture_state = PanelTexture::Raw;
+	uint64_t _last_change_time = 0;
+
+	vr::Texture_t _cursor_texture;
+	int _cursor_serial = -1;
+	CursorPos _cursor_last_pos = {-1, -1};
+	float _cursor_last_width = 0;
+
+	// owned by this panel from the capture request until its upload, nullptr when capturing without MIT-SHM
+	CaptureBuffer *_capture_buffer = nullptr;
+	ChangeDetector _changes;
+	// the capture whose tiles are being uploaded, kept over several frames if they exceed the budget
+	CaptureBuffer *_upload_buffer = nullptr;
+	xcb_get_image_reply_t *_upload_reply = nullptr;
+	const uint8_t *_upload_pixels = nullptr;
+	std::vector<uint8_t> _converted; // empty unless the root window is not BGRX
+	uint64_t _upload_capture_time;
+	size_t _upload_bytes;
+	bool _full_upload = false; // the whole capture, without tile uploads
+	bool _texture_changed = false; // not yet handed to SteamVR
+	CursorPos _focus = {-1, -1};
+	UploadFocus _focus_rank = UploadFocus::Anywhere;
+	bool _capture_pending = false;
+	uint64_t _capture_time;
+	xcb_shm_get_image_cookie_t _shm_cookie;
+	xcb_get_image_cookie_t _image_cookie;
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "perfcounters.h"
+#include "profiler.h"
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace PerfCounters
+{
+bool enabled = false;
+}
+
+static int group_fd = -1;
+static uint64_t stage_totals[STAGE_COUNT][PERF_COUNTER_COUNT];
+
+static int OpenCounter(uint32_t type, uint64_t config, int group)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.disabled = group == -1;
+	// kernel counting usually needs privileges, and our own code is what we are interested in
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+namespace PerfCounters
+{
+
+bool Start()
+{
+	// the order has to match PerfCounter
+	group_fd = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+	int fds[] = {
+		OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, group_fd),
+		OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, group_fd),
+		OpenCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, group_fd),
+	};
+	bool ok = group_fd != -1;
+	for (int fd : fds)
+	{
+		ok &= fd != -1;
+	}
+	if (!ok)
+	{
+		printf("Could not open perf counters, check /proc/sys/kernel/perf_event_paranoid\n");
+		for (int fd : fds)
+		{
+			if (fd != -1)
+				close(fd);
+		}
+		if (group_fd != -1)
+			close(group_fd);
+		return false;
+	}
+	ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	enabled = true;
+	printf("Sampling perf counters at stage boundaries\n");
+	return true;
+}
+
+void Read(uint64_t values[PERF_COUNTER_COUNT])
+{
+	struct
+	{
+		uint64_t count;
+		uint64_t values[PERF_COUNTER_COUNT];
+	} group;
+	if (read(group_fd, &group, sizeof(group)) != sizeof(group))
+	{
+		memset(values, 0, sizeof(uint64_t) * PERF_COUNTER_COUNT);
+		return;
+	}
+	memcpy(values, group.values, sizeof(group.values));
+}
+
+void AddStage(int stage, const uint64_t start[PERF_COUNTER_COUNT], const uint64_t end[PERF_COUNTER_COUNT])
+{
+	for (int i = 0; i < PERF_COUNTER_COUNT; i++)
+	{
+		stage_totals[stage][i] += end[i] - start[i];
+	}
+}
+
+void Reset()
+{
+	memset(stage_totals, 0, sizeof(stage_totals));
+}
+
+void Report()
+{
+	if (!enabled)
+	{
+		return;
+	}
+	double captured_mb = Profiler::CapturedBytes() / (1024.0 * 1024.0);
+	printf("%-18s %12s %6s %12s %12s %10s  (main thread only, captured %.0f MB)\n", "stage", "cycles", "IPC", "cache miss", "miss/MB", "faults", captured_mb);
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		auto totals = stage_totals[i];
+		if (totals[(int)PerfCounter::Cycles] == 0)
+		{
+			continue;
+		}
+		double ipc = totals[(int)PerfCounter::Instructions] / (double)totals[(int)PerfCounter::Cycles];
+		double misses_per_mb = captured_mb > 0 ? totals[(int)PerfCounter::CacheMisses] / captured_mb : 0;
+		printf("%-18s %12lu %6.2f %12lu %12.0f %10lu\n",
+			   Profiler::StageName((Stage)i),
+			   totals[(int)PerfCounter::Cycles],
+			   ipc,
+			   totals[(int)PerfCounter::CacheMisses],
+			   misses_per_mb,
+			   totals[(int)PerfCounter::PageFaults]);
+	}
+}
+
+} // namespace PerfCounters
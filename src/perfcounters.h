@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+// hardware counters of the main thread through perf_event_open, sampled at the start and end of
+// every profiled stage (only in SINPIN_PROFILE builds, enabled with --perf-counters). The counters are
+// not inherited, so the BC1 encoder threads and driver threads are not included
+enum class PerfCounter
+{
+	Cycles,
+	Instructions,
+	CacheMisses,
+	PageFaults,
+};
+const int PERF_COUNTER_COUNT = (int)PerfCounter::PageFaults + 1;
+
+namespace PerfCounters
+{
+extern bool enabled;
+
+bool Start();
+void Read(uint64_t values[PERF_COUNTER_COUNT]);
+void AddStage(int stage, const uint64_t start[PERF_COUNTER_COUNT], const uint64_t end[PERF_COUNTER_COUNT]);
+// clears the stage totals, with Profiler::Reset
+void Reset();
+void Report();
+} // namespace PerfCounters
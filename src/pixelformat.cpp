@@ -0,0 +1,248 @@
+#include "pixelformat.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PIXEL_KERNELS_X86
+#endif
+
+// converts one row of width pixels
+typedef void (*RowKernel)(const uint8_t *src, uint8_t *dst, int width);
+
+struct Kernels
+{
+	const char *name;
+	RowKernel x2r10g10b10;
+	RowKernel r5g6b5;
+};
+
+// the top 8 bits of every 10 bit channel
+static inline uint32_t Convert2101010(uint32_t v)
+{
+	return 0xff000000 | ((v >> 6) & 0xff0000) | ((v >> 4) & 0xff00) | ((v >> 2) & 0xff);
+}
+
+// 5 and 6 bit channels repeat their top bits below, so 0 stays 0 and the maximum becomes 255
+static inline uint32_t Convert565(uint32_t v)
+{
+	uint32_t r = ((v << 8) & 0xf80000) | ((v << 3) & 0x070000);
+	uint32_t g = ((v << 5) & 0xfc00) | ((v >> 1) & 0x0300);
+	uint32_t b = ((v << 3) & 0xf8) | ((v >> 2) & 0x07);
+	return 0xff000000 | r | g | b;
+}
+
+static void Row2101010Scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+	for (int x = 0; x < width; x++)
+	{
+		uint32_t v;
+		memcpy(&v, src + x * 4, 4);
+		v = Convert2101010(v);
+		memcpy(dst + x * 4, &v, 4);
+	}
+}
+
+static void Row565Scalar(const uint8_t *src, uint8_t *dst, int width)
+{
+	for (int x = 0; x < width; x++)
+	{
+		uint16_t v;
+		memcpy(&v, src + x * 2, 2);
+		uint32_t out = Convert565(v);
+		memcpy(dst + x * 4, &out, 4);
+	}
+}
+
+#ifdef PIXEL_KERNELS_X86
+// the same arithmetic as the scalar versions on 4 or 8 pixels at once, the rest of a row goes through those
+
+__attribute__((target("sse2"))) static inline __m128i Convert2101010Sse2(__m128i v)
+{
+	__m128i r = _mm_and_si128(_mm_srli_epi32(v, 6), _mm_set1_epi32(0xff0000));
+	__m128i g = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi32(0xff00));
+	__m128i b = _mm_and_si128(_mm_srli_epi32(v, 2), _mm_set1_epi32(0xff));
+	return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32(0xff000000)));
+}
+
+// v holds 4 pixels zero extended to 32 bits
+__attribute__((target("sse2"))) static inline __m128i Convert565Sse2(__m128i v)
+{
+	__m128i r = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(v, 8), _mm_set1_epi32(0xf80000)),
+							 _mm_and_si128(_mm_slli_epi32(v, 3), _mm_set1_epi32(0x070000)));
+	__m128i g = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(v, 5), _mm_set1_epi32(0xfc00)),
+							 _mm_and_si128(_mm_srli_epi32(v, 1), _mm_set1_epi32(0x0300)));
+	__m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(v, 3), _mm_set1_epi32(0xf8)),
+							 _mm_and_si128(_mm_srli_epi32(v, 2), _mm_set1_epi32(0x07)));
+	return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_set1_epi32(0xff000000)));
+}
+
+__attribute__((target("sse2"))) static void Row2101010Sse2(const uint8_t *src, uint8_t *dst, int width)
+{
+	int x = 0;
+	for (; x + 4 <= width; x += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + x * 4));
+		_mm_storeu_si128((__m128i *)(dst + x * 4), Convert2101010Sse2(v));
+	}
+	Row2101010Scalar(src + x * 4, dst + x * 4, width - x);
+}
+
+__attribute__((target("sse2"))) static void Row565Sse2(const uint8_t *src, uint8_t *dst, int width)
+{
+	int x = 0;
+	__m128i zero = _mm_setzero_si128();
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + x * 2));
+		_mm_storeu_si128((__m128i *)(dst + x * 4), Convert565Sse2(_mm_unpacklo_epi16(v, zero)));
+		_mm_storeu_si128((__m128i *)(dst + x * 4 + 16), Convert565Sse2(_mm_unpackhi_epi16(v, zero)));
+	}
+	Row565Scalar(src + x * 2, dst + x * 4, width - x);
+}
+
+__attribute__((target("avx2"))) static inline __m256i Convert2101010Avx2(__m256i v)
+{
+	__m256i r = _mm256_and_si256(_mm256_srli_epi32(v, 6), _mm256_set1_epi32(0xff0000));
+	__m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 4), _mm256_set1_epi32(0xff00));
+	__m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 2), _mm256_set1_epi32(0xff));
+	return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, _mm256_set1_epi32(0xff000000)));
+}
+
+__attribute__((target("avx2"))) static inline __m256i Convert565Avx2(__m256i v)
+{
+	__m256i r = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(v, 8), _mm256_set1_epi32(0xf80000)),
+								_mm256_and_si256(_mm256_slli_epi32(v, 3), _mm256_set1_epi32(0x070000)));
+	__m256i g = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(v, 5), _mm256_set1_epi32(0xfc00)),
+								_mm256_and_si256(_mm256_srli_epi32(v, 1), _mm256_set1_epi32(0x0300)));
+	__m256i b = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(v, 3), _mm256_set1_epi32(0xf8)),
+								_mm256_and_si256(_mm256_srli_epi32(v, 2), _mm256_set1_epi32(0x07)));
+	return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, _mm256_set1_epi32(0xff000000)));
+}
+
+__attribute__((target("avx2"))) static void Row2101010Avx2(const uint8_t *src, uint8_t *dst, int width)
+{
+	int x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(src + x * 4));
+		_mm256_storeu_si256((__m256i *)(dst + x * 4), Convert2101010Avx2(v));
+	}
+	Row2101010Scalar(src + x * 4, dst + x * 4, width - x);
+}
+
+__attribute__((target("avx2"))) static void Row565Avx2(const uint8_t *src, uint8_t *dst, int width)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		// zero extending 8 pixels at a time keeps them in order, unpacking would work per 128 bit lane
+		__m256i low = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + x * 2)));
+		__m256i high = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + x * 2 + 16)));
+		_mm256_storeu_si256((__m256i *)(dst + x * 4), Convert565Avx2(low));
+		_mm256_storeu_si256((__m256i *)(dst + x * 4 + 32), Convert565Avx2(high));
+	}
+	Row565Scalar(src + x * 2, dst + x * 4, width - x);
+}
+#endif
+
+const int MAX_KERNELS = 3;
+
+struct KernelList
+{
+	Kernels kernels[MAX_KERNELS];
+	int count;
+};
+
+// the scalar kernels first, the fastest ones last
+static KernelList FindKernels()
+{
+	KernelList list;
+	list.kernels[0] = Kernels{"scalar", Row2101010Scalar, Row565Scalar};
+	list.count = 1;
+#ifdef PIXEL_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		list.kernels[list.count++] = Kernels{"sse2", Row2101010Sse2, Row565Sse2};
+	if (__builtin_cpu_supports("avx2"))
+		list.kernels[list.count++] = Kernels{"avx2", Row2101010Avx2, Row565Avx2};
+#endif
+	return list;
+}
+
+static const KernelList &AvailableKernels()
+{
+	static const KernelList list = FindKernels();
+	return list;
+}
+
+PixelFormat FindPixelFormat(int bits_per_pixel, bool lsb_first, uint32_t red_mask, uint32_t green_mask, uint32_t blue_mask)
+{
+	if (!lsb_first)
+		return PixelFormat::Unsupported;
+	if (bits_per_pixel == 32 && red_mask == 0xff0000 && green_mask == 0xff00 && blue_mask == 0xff)
+		return PixelFormat::BGRX;
+	if (bits_per_pixel == 32 && red_mask == 0x3ff00000 && green_mask == 0xffc00 && blue_mask == 0x3ff)
+		return PixelFormat::X2R10G10B10;
+	if (bits_per_pixel == 16 && red_mask == 0xf800 && green_mask == 0x7e0 && blue_mask == 0x1f)
+		return PixelFormat::R5G6B5;
+	return PixelFormat::Unsupported;
+}
+
+const char *PixelFormatName(PixelFormat format)
+{
+	switch (format)
+	{
+	case PixelFormat::BGRX:
+		return "BGRX";
+	case PixelFormat::X2R10G10B10:
+		return "x2r10g10b10";
+	case PixelFormat::R5G6B5:
+		return "r5g6b5";
+	case PixelFormat::Unsupported:
+		return "unsupported";
+	}
+	return "unknown";
+}
+
+int BitsPerPixel(PixelFormat format)
+{
+	return format == PixelFormat::R5G6B5 ? 16 : 32;
+}
+
+size_t ZPixmapStride(PixelFormat format, int width, int scanline_pad)
+{
+	size_t bits = (size_t)width * BitsPerPixel(format);
+	return (bits + scanline_pad - 1) / scanline_pad * scanline_pad / 8;
+}
+
+void ConvertToBgrx(PixelFormat format, const uint8_t *src, size_t src_stride, uint8_t *dst, int width, int height)
+{
+	ConvertToBgrxWith(PixelKernelCount() - 1, format, src, src_stride, dst, width, height);
+}
+
+void ConvertToBgrxWith(int kernel, PixelFormat format, const uint8_t *src, size_t src_stride, uint8_t *dst, int width, int height)
+{
+	auto &kernels = AvailableKernels().kernels[kernel];
+	RowKernel row = nullptr;
+	if (format == PixelFormat::X2R10G10B10)
+		row = kernels.x2r10g10b10;
+	else if (format == PixelFormat::R5G6B5)
+		row = kernels.r5g6b5;
+	size_t dst_stride = (size_t)width * 4;
+	for (int y = 0; y < height; y++)
+	{
+		if (row != nullptr)
+			row(src + y * src_stride, dst + y * dst_stride, width);
+		else
+			memcpy(dst + y * dst_stride, src + y * src_stride, dst_stride);
+	}
+}
+
+int PixelKernelCount()
+{
+	return AvailableKernels().count;
+}
+
+const char *PixelKernelName(int kernel)
+{
+	return AvailableKernels().kernels[kernel].name;
+}
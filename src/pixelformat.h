@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// layouts of the root window's ZPixmap, everything after the capture works on 32 bit BGRX
+enum class PixelFormat
+{
+	BGRX,        // depth 24 and 32, used as it is
+	X2R10G10B10, // depth 30, deep color
+	R5G6B5,      // depth 16
+	Unsupported,
+};
+
+// picks the format from the root visual's masks, the bits per pixel of its depth and the server's image
+// byte order, the kernels read pixels least significant byte first
+PixelFormat FindPixelFormat(int bits_per_pixel, bool lsb_first, uint32_t red_mask, uint32_t green_mask, uint32_t blue_mask);
+const char *PixelFormatName(PixelFormat format);
+int BitsPerPixel(PixelFormat format);
+// bytes per row of a ZPixmap, rows are padded to scanline_pad bits
+size_t ZPixmapStride(PixelFormat format, int width, int scanline_pad);
+
+// converts an image to BGRX with the fastest kernels the CPU supports (AVX2, SSE2 or scalar)
+void ConvertToBgrx(PixelFormat format, const uint8_t *src, size_t src_stride, uint8_t *dst, int width, int height);
+
+// every set of kernels this CPU can run, so they can be checked against each other: 0 is the plain C
+// reference the SIMD ones have to match exactly, the last one is what ConvertToBgrx uses
+int PixelKernelCount();
+const char *PixelKernelName(int kernel);
+void ConvertToBgrxWith(int kernel, PixelFormat format, const uint8_t *src, size_t src_stride, uint8_t *dst, int width, int height);
@@ -0,0 +1,21 @@
+#pragma once
+
+// USDT probes, a single nop each until a tracer attaches, eg.
+//   bpftrace -e 'usdt:./sinpin_vr:sinpin:frame_end { @[arg0] = nsecs; }'
+// probes are left out if systemtap's sys/sdt.h is not installed
+//
+// frame_start(frame), frame_end(frame)
+// capture_begin(panel, bytes), capture_end(panel, bytes)
+// texture_submit_begin(panel), texture_submit_end(panel)
+// pointer_warp(x, y), button_inject(button, state)
+// span_begin(name), span_end(name) around every traced scope, which includes all OpenVR calls ("IVR...")
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PROBE(name) DTRACE_PROBE(sinpin, name)
+#define PROBE1(name, a) DTRACE_PROBE1(sinpin, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(sinpin, name, a, b)
+#else
+#define PROBE(name)
+#define PROBE1(name, a)
+#define PROBE2(name, a, b)
+#endif
@@ -0,0 +1,301 @@
+#include "profiler.h"
+#include <cstdio>
+
+const uint64_t REPORT_INTERVAL_NS = 10 * 1000000000ull;
+
+static Histogram histograms[STAGE_COUNT];
+// since the last periodic report, which starts them over
+static Histogram interval_histograms[STAGE_COUNT];
+static std::atomic<uint64_t> captured_bytes = {0};
+static std::atomic<uint64_t> uploaded_bytes = {0};
+static std::atomic<uint64_t> tiles_changed = {0};
+static std::atomic<uint64_t> tiles_total = {0};
+static std::atomic<uint64_t> scrolls = {0};
+static std::atomic<uint64_t> shifted_bytes = {0};
+static uint64_t last_report = 0;
+static uint64_t cpu_at_reset = 0; // process CPU time at the last Reset, so the json covers the same window
+
+static int BucketIndex(uint64_t value)
+{
+	if (value < HISTOGRAM_SUB_COUNT)
+	{
+		return value;
+	}
+	int msb = 63 - __builtin_clzll(value);
+	int shift = msb - HISTOGRAM_SUB_BITS;
+	return (shift + 1) * HISTOGRAM_SUB_COUNT + ((value >> shift) & (HISTOGRAM_SUB_COUNT - 1));
+}
+
+// middle of the value range covered by a bucket
+static uint64_t BucketValue(int index)
+{
+	if (index < HISTOGRAM_SUB_COUNT)
+	{
+		return index;
+	}
+	int shift = index / HISTOGRAM_SUB_COUNT - 1;
+	uint64_t sub = index % HISTOGRAM_SUB_COUNT;
+	return ((HISTOGRAM_SUB_COUNT + sub) << shift) + ((1ull << shift) >> 1);
+}
+
+void Histogram::Record(uint64_t value)
+{
+	_buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	_count.fetch_add(1, std::memory_order_relaxed);
+	_sum.fetch_add(value, std::memory_order_relaxed);
+	uint64_t max = _max.load(std::memory_order_relaxed);
+	while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+	{
+	}
+}
+
+void Histogram::Reset()
+{
+	for (auto &bucket : _buckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	_count.store(0, std::memory_order_relaxed);
+	_sum.store(0, std::memory_order_relaxed);
+	_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::Count()
+{
+	return _count.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::Max()
+{
+	return _max.load(std::memory_order_relaxed);
+}
+
+double Histogram::Mean()
+{
+	uint64_t count = Count();
+	return count ? _sum.load(std::memory_order_relaxed) / (double)count : 0;
+}
+
+uint64_t Histogram::Percentile(float percentile)
+{
+	uint64_t count = Count();
+	if (count == 0)
+	{
+		return 0;
+	}
+	uint64_t target = (uint64_t)(count * percentile / 100.0f);
+	if (target >= count)
+	{
+		target = count - 1;
+	}
+	uint64_t seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += _buckets[i].load(std::memory_order_relaxed);
+		if (seen > target)
+		{
+			uint64_t value = BucketValue(i);
+			return value < Max() ? value : Max();
+		}
+	}
+	return Max();
+}
+
+namespace Profiler
+{
+
+void Record(Stage stage, uint64_t nanoseconds)
+{
+	histograms[(int)stage].Record(nanoseconds);
+	interval_histograms[(int)stage].Record(nanoseconds);
+}
+
+Histogram *Get(Stage stage)
+{
+	return &histograms[(int)stage];
+}
+
+const char *StageName(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::Frame:
+		return "frame";
+	case Stage::FrameCpu:
+		return "frame cpu";
+	case Stage::Input:
+		return "input";
+	case Stage::Framebuffer:
+		return "framebuffer";
+	case Stage::Render:
+		return "panel render";
+	case Stage::Cursor:
+		return "panel cursor";
+	case Stage::ControllerLeft:
+		return "controller left";
+	case Stage::ControllerRight:
+		return "controller right";
+	case Stage::CaptureWait:
+		return "capture wait";
+	case Stage::Upload:
+		return "upload";
+	case Stage::Submit:
+		return "submit";
+	case Stage::Picking:
+		return "picking";
+	case Stage::TileHash:
+		return "tile hash";
+	case Stage::Convert:
+		return "convert";
+	case Stage::CaptureLatency:
+		return "capture latency";
+	}
+	return "unknown";
+}
+
+void AddCapturedBytes(uint64_t bytes)
+{
+	captured_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+uint64_t CapturedBytes()
+{
+	return captured_bytes.load(std::memory_order_relaxed);
+}
+
+void AddUploadedBytes(uint64_t bytes)
+{
+	uploaded_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+uint64_t UploadedBytes()
+{
+	return uploaded_bytes.load(std::memory_order_relaxed);
+}
+
+void AddTiles(uint64_t changed, uint64_t total)
+{
+	tiles_changed.fetch_add(changed, std::memory_order_relaxed);
+	tiles_total.fetch_add(total, std::memory_order_relaxed);
+}
+
+void AddScroll(uint64_t bytes)
+{
+	scrolls.fetch_add(1, std::memory_order_relaxed);
+	shifted_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static double ChangedPercent()
+{
+	uint64_t total = tiles_total.load(std::memory_order_relaxed);
+	return total ? 100.0 * tiles_changed.load(std::memory_order_relaxed) / total : 0;
+}
+
+static void PrintStages(Histogram *stages)
+{
+	printf("%-18s %8s %10s %10s %10s\n", "stage (us)", "count", "p50", "p99", "max");
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		auto hist = &stages[i];
+		printf("%-18s %8lu %10.1f %10.1f %10.1f\n",
+			   StageName((Stage)i),
+			   hist->Count(),
+			   hist->Percentile(50) / 1000.0,
+			   hist->Percentile(99) / 1000.0,
+			   hist->Max() / 1000.0);
+	}
+}
+
+static void PrintTotals()
+{
+	printf("tiles changed per capture: %.1f%%, uploaded %.1f MB of %.1f MB captured\n",
+		   ChangedPercent(),
+		   UploadedBytes() / 1e6,
+		   CapturedBytes() / 1e6);
+	printf("scrolls: %lu, moving %.1f MB on the GPU\n",
+		   scrolls.load(std::memory_order_relaxed),
+		   shifted_bytes.load(std::memory_order_relaxed) / 1e6);
+}
+
+void Report()
+{
+	printf("since start:\n");
+	PrintStages(histograms);
+	PrintTotals();
+	PerfCounters::Report();
+}
+
+void Tick()
+{
+	uint64_t now = ClockNanoseconds(CLOCK_MONOTONIC);
+	if (last_report == 0)
+	{
+		last_report = now;
+	}
+	else if (now - last_report > REPORT_INTERVAL_NS)
+	{
+		printf("last %.0f s:\n", (now - last_report) / 1e9);
+		PrintStages(interval_histograms);
+		for (auto &hist : interval_histograms)
+		{
+			hist.Reset();
+		}
+		printf("since start: ");
+		PrintTotals();
+		last_report = now;
+	}
+}
+
+void Reset()
+{
+	for (auto &hist : histograms)
+	{
+		hist.Reset();
+	}
+	for (auto &hist : interval_histograms)
+	{
+		hist.Reset();
+	}
+	captured_bytes.store(0, std::memory_order_relaxed);
+	uploaded_bytes.store(0, std::memory_order_relaxed);
+	tiles_changed.store(0, std::memory_order_relaxed);
+	tiles_total.store(0, std::memory_order_relaxed);
+	scrolls.store(0, std::memory_order_relaxed);
+	shifted_bytes.store(0, std::memory_order_relaxed);
+	cpu_at_reset = ClockNanoseconds(CLOCK_PROCESS_CPUTIME_ID);
+	PerfCounters::Reset();
+}
+
+bool WriteJson(const char *path)
+{
+	FILE *file = fopen(path, "w");
+	if (file == nullptr)
+	{
+		printf("Could not write stats to %s\n", path);
+		return false;
+	}
+	fprintf(file, "{\"captured_bytes\":%lu,\"uploaded_bytes\":%lu,\"tiles_changed_percent\":%.2f,\"scrolls\":%lu,\"shifted_bytes\":%lu,\"cpu_seconds\":%.3f,\"stages\":{",
+			CapturedBytes(),
+			UploadedBytes(),
+			ChangedPercent(),
+			scrolls.load(std::memory_order_relaxed),
+			shifted_bytes.load(std::memory_order_relaxed),
+			(ClockNanoseconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_at_reset) / 1e9);
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		auto hist = &histograms[i];
+		fprintf(file, "%s\n\"%s\":{\"count\":%lu,\"mean_us\":%.2f,\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}",
+				i ? "," : "",
+				StageName((Stage)i),
+				hist->Count(),
+				hist->Mean() / 1000.0,
+				hist->Percentile(50) / 1000.0,
+				hist->Percentile(99) / 1000.0,
+				hist->Max() / 1000.0);
+	}
+	fprintf(file, "\n}}\n");
+	fclose(file);
+	return true;
+}
+
+} // namespace Profiler
@@ -0,0 +1,135 @@
+#pragma once
+#include "perfcounters.h"
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+// stages of App::Update that get timed when building with SINPIN_PROFILE (make profile)
+enum class Stage
+{
+	Frame,
+	FrameCpu, // process cpu time spent in the whole frame
+	Input,
+	Framebuffer,
+	Render,
+	Cursor,
+	ControllerLeft,
+	ControllerRight,
+	CaptureWait, // waiting for a capture reply, part of Render
+	Upload,      // part of Render
+	Submit,      // SetOverlayTexture, part of Render
+	Picking,     // App::IntersectRay
+	TileHash,    // finding changed tiles, part of Render
+	Convert,     // converting 16 and 30 bit captures to BGRX, part of Render
+	CaptureLatency, // from requesting a capture until its texture is handed to SteamVR
+};
+const int STAGE_COUNT = (int)Stage::CaptureLatency + 1;
+
+// log-linear histogram in the style of HdrHistogram, values are nanoseconds
+// 16 sub buckets per power of two keep the error of any reported value below ~6%
+const int HISTOGRAM_SUB_BITS = 4;
+const int HISTOGRAM_SUB_COUNT = 1 << HISTOGRAM_SUB_BITS;
+const int HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT;
+
+class Histogram
+{
+  public:
+	void Record(uint64_t value);
+	void Reset();
+
+	uint64_t Count();
+	uint64_t Max();
+	double Mean();
+	uint64_t Percentile(float percentile);
+
+  private:
+	std::atomic<uint64_t> _buckets[HISTOGRAM_BUCKETS] = {};
+	std::atomic<uint64_t> _count = {0};
+	std::atomic<uint64_t> _sum = {0};
+	std::atomic<uint64_t> _max = {0};
+};
+
+namespace Profiler
+{
+void Record(Stage stage, uint64_t nanoseconds);
+Histogram *Get(Stage stage);
+const char *StageName(Stage stage);
+void AddCapturedBytes(uint64_t bytes);
+uint64_t CapturedBytes();
+void AddUploadedBytes(uint64_t bytes);
+uint64_t UploadedBytes();
+// tiles of a capture that changed since the previous one, out of total
+void AddTiles(uint64_t changed, uint64_t total);
+// content moved within a texture instead of being uploaded again
+void AddScroll(uint64_t bytes);
+// everything since startup or the last Reset
+void Report();
+// prints the stages of the last few seconds every few seconds
+void Tick();
+// starts over, eg. after a benchmark has warmed up
+void Reset();
+// machine readable summary for bench/bench.py
+bool WriteJson(const char *path);
+} // namespace Profiler
+
+inline uint64_t ClockNanoseconds(clockid_t clock)
+{
+	timespec t;
+	clock_gettime(clock, &t);
+	return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+class ProfileScope
+{
+  public:
+	ProfileScope(Stage stage, clockid_t clock = CLOCK_MONOTONIC)
+		: _stage(stage), _clock(clock)
+	{
+		// the cpu time scope covers the same code as the frame scope
+		_sample_counters = PerfCounters::enabled && stage != Stage::FrameCpu;
+		if (_sample_counters)
+			PerfCounters::Read(_counters);
+		_start = ClockNanoseconds(clock);
+	}
+	~ProfileScope()
+	{
+		Profiler::Record(_stage, ClockNanoseconds(_clock) - _start);
+		if (_sample_counters)
+		{
+			uint64_t counters[PERF_COUNTER_COUNT];
+			PerfCounters::Read(counters);
+			PerfCounters::AddStage((int)_stage, _counters, counters);
+		}
+	}
+
+  private:
+	Stage _stage;
+	clockid_t _clock;
+	uint64_t _start;
+	bool _sample_counters;
+	uint64_t _counters[PERF_COUNTER_COUNT];
+};
+
+#ifdef SINPIN_PROFILE
+#define PROFILE_STAGE(stage) ProfileScope _profile_scope(stage)
+#define PROFILE_FRAME()                                 \
+	ProfileScope _profile_frame_scope(Stage::Frame); \
+	ProfileScope _profile_frame_cpu_scope(Stage::FrameCpu, CLOCK_PROCESS_CPUTIME_ID)
+#define PROFILE_RECORD(stage, nanoseconds) Profiler::Record(stage, nanoseconds)
+#define PROFILE_TICK() Profiler::Tick()
+#define PROFILE_REPORT() Profiler::Report()
+#define PROFILE_CAPTURED_BYTES(bytes) Profiler::AddCapturedBytes(bytes)
+#define PROFILE_UPLOADED_BYTES(bytes) Profiler::AddUploadedBytes(bytes)
+#define PROFILE_TILES(changed, total) Profiler::AddTiles(changed, total)
+#define PROFILE_SCROLL(bytes) Profiler::AddScroll(bytes)
+#else
+#define PROFILE_STAGE(stage)
+#define PROFILE_FRAME()
+#define PROFILE_RECORD(stage, nanoseconds)
+#define PROFILE_TICK()
+#define PROFILE_REPORT()
+#define PROFILE_CAPTURED_BYTES(bytes)
+#define PROFILE_UPLOADED_BYTES(bytes)
+#define PROFILE_TILES(changed, total)
+#define PROFILE_SCROLL(bytes)
+#endif
@@ -0,0 +1,90 @@
+#include "trace.h"
+#include <atomic>
+#include <cstdio>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Trace
+{
+bool enabled = false;
+uint32_t frame = 0;
+int panel = -1;
+} // namespace Trace
+
+static const char *trace_path;
+static TraceEvent *events;
+static size_t capacity;
+static std::atomic<uint64_t> event_count;
+static uint64_t start_time;
+
+static uint32_t ThreadId()
+{
+	static thread_local uint32_t id = syscall(SYS_gettid);
+	return id;
+}
+
+namespace Trace
+{
+
+void Start(const char *path, size_t event_capacity)
+{
+	events = new TraceEvent[event_capacity];
+	capacity = event_capacity;
+	trace_path = path;
+	event_count = 0;
+	start_time = ClockNanoseconds(CLOCK_MONOTONIC);
+	enabled = true;
+	printf("Tracing to %s, keeping the last %zu events\n", path, capacity);
+}
+
+void Add(const char *name, uint64_t start, uint64_t end)
+{
+	uint64_t index = event_count.fetch_add(1, std::memory_order_relaxed);
+	TraceEvent &event = events[index % capacity];
+	event.name = name;
+	event.start = start;
+	event.duration = end - start;
+	event.frame = frame;
+	event.panel = panel;
+	event.thread = ThreadId();
+}
+
+void Write()
+{
+	if (!enabled)
+	{
+		return;
+	}
+	FILE *file = fopen(trace_path, "w");
+	if (file == nullptr)
+	{
+		printf("Could not open trace file %s\n", trace_path);
+		return;
+	}
+	uint64_t count = event_count.load(std::memory_order_relaxed);
+	uint64_t first = count > capacity ? count - capacity : 0;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"sinpin_vr\"}}", getpid());
+	for (uint64_t i = first; i < count; i++)
+	{
+		TraceEvent &event = events[i % capacity];
+		fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u,\"args\":{\"frame\":%u",
+				event.name,
+				(event.start - start_time) / 1000.0,
+				event.duration / 1000.0,
+				getpid(),
+				event.thread,
+				event.frame);
+		if (event.panel >= 0)
+		{
+			fprintf(file, ",\"panel\":%d", event.panel);
+		}
+		fprintf(file, "}}");
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	printf("Wrote %lu trace events to %s\n", count - first, trace_path);
+}
+
+} // namespace Trace
@@ -0,0 +1,76 @@
+#pragma once
+#include "probes.h"
+#include "profiler.h"
+#include <cstddef>
+#include <cstdint>
+
+// Chrome trace event recording (view the output in Perfetto or chrome://tracing)
+// events go into a preallocated ring buffer that keeps the most recent ones, and are only written out
+// on exit or when SIGUSR1 is received
+struct TraceEvent
+{
+	const char *name;
+	uint64_t start;
+	uint64_t duration;
+	uint32_t frame;
+	int32_t panel;
+	uint32_t thread;
+};
+
+const size_t TRACE_DEFAULT_CAPACITY = 1 << 20;
+
+namespace Trace
+{
+extern bool enabled;
+// tags attached to every event
+extern uint32_t frame;
+extern int panel;
+
+void Start(const char *path, size_t capacity = TRACE_DEFAULT_CAPACITY);
+void Add(const char *name, uint64_t start, uint64_t end);
+void Write();
+} // namespace Trace
+
+class TraceScope
+{
+  public:
+	TraceScope(const char *name)
+		: _name(name), _start(Trace::enabled ? ClockNanoseconds(CLOCK_MONOTONIC) : 0)
+	{
+		PROBE1(span_begin, name);
+	}
+	~TraceScope()
+	{
+		PROBE1(span_end, _name);
+		if (Trace::enabled)
+			Trace::Add(_name, _start, ClockNanoseconds(CLOCK_MONOTONIC));
+	}
+
+  private:
+	const char *_name;
+	uint64_t _start;
+};
+
+// sets the panel tag for everything recorded until the end of the scope
+class TracePanelScope
+{
+  public:
+	TracePanelScope(int panel) : _previous(Trace::panel)
+	{
+		Trace::panel = panel;
+	}
+	~TracePanelScope()
+	{
+		Trace::panel = _previous;
+	}
+
+  private:
+	int _previous;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(_trace_scope_, __LINE__)(name)
+#define TRACE_PANEL(index) TracePanelScope _trace_panel_scope(index)
+// traces a single call in the middle of an expression, eg. `auto reply = TRACE_CALL("name", xcb_..._reply(...));`
+#define TRACE_CALL(name, call) ([&]() { TRACE_SCOPE(name); return call; }())
@@ -0,0 +1,136 @@
+#include "uinput.h"
+#include "trace.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+UInputDevice::UInputDevice()
+{
+	_fd = -1;
+	_event_count = 0;
+}
+
+UInputDevice::~UInputDevice()
+{
+	if (_fd != -1)
+	{
+		ioctl(_fd, UI_DEV_DESTROY);
+		close(_fd);
+	}
+}
+
+bool UInputDevice::IsOpen()
+{
+	return _fd != -1;
+}
+
+bool UInputDevice::CreateScrollWheel()
+{
+	_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+	if (_fd == -1)
+	{
+		return false;
+	}
+	// without motion axes and a button, the device would not be picked up as a pointer
+	ioctl(_fd, UI_SET_EVBIT, EV_KEY);
+	ioctl(_fd, UI_SET_KEYBIT, BTN_LEFT);
+	ioctl(_fd, UI_SET_EVBIT, EV_REL);
+	ioctl(_fd, UI_SET_RELBIT, REL_X);
+	ioctl(_fd, UI_SET_RELBIT, REL_Y);
+	ioctl(_fd, UI_SET_RELBIT, REL_WHEEL);
+	ioctl(_fd, UI_SET_RELBIT, REL_WHEEL_HI_RES);
+	return Create("sinpin-vr scroll");
+}
+
+bool UInputDevice::CreateAbsolutePointer(int width, int height)
+{
+	_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+	if (_fd == -1)
+	{
+		return false;
+	}
+	ioctl(_fd, UI_SET_EVBIT, EV_KEY);
+	ioctl(_fd, UI_SET_KEYBIT, BTN_LEFT);
+	ioctl(_fd, UI_SET_KEYBIT, BTN_RIGHT);
+	ioctl(_fd, UI_SET_KEYBIT, BTN_MIDDLE);
+	ioctl(_fd, UI_SET_EVBIT, EV_ABS);
+	ioctl(_fd, UI_SET_PROPBIT, INPUT_PROP_POINTER);
+
+	uinput_abs_setup abs;
+	memset(&abs, 0, sizeof(abs));
+	abs.code = ABS_X;
+	abs.absinfo.maximum = width - 1;
+	ioctl(_fd, UI_ABS_SETUP, &abs);
+	abs.code = ABS_Y;
+	abs.absinfo.maximum = height - 1;
+	ioctl(_fd, UI_ABS_SETUP, &abs);
+	return Create("sinpin-vr pointer");
+}
+
+bool UInputDevice::Create(const char *name)
+{
+	uinput_setup setup;
+	memset(&setup, 0, sizeof(setup));
+	setup.id.bustype = BUS_VIRTUAL;
+	setup.id.vendor = 0x1209; // pid.codes test vendor
+	setup.id.product = 0x0001;
+	strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+
+	if (ioctl(_fd, UI_DEV_SETUP, &setup) == -1 || ioctl(_fd, UI_DEV_CREATE) == -1)
+	{
+		printf("Could not create uinput device %s\n", name);
+		close(_fd);
+		_fd = -1;
+		return false;
+	}
+	printf("Created uinput device %s\n", name);
+	return true;
+}
+
+void UInputDevice::Emit(uint16_t type, uint16_t code, int32_t value)
+{
+	// keep one slot free for the final SYN_REPORT
+	if (_event_count >= UINPUT_MAX_EVENTS - 1)
+	{
+		Flush();
+	}
+	input_event &event = _events[_event_count++];
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	event.code = code;
+	event.value = value;
+}
+
+// ends the current event frame, the kernel only passes on events once they are followed by a SYN_REPORT
+void UInputDevice::Sync()
+{
+	if (_event_count == 0 || _events[_event_count - 1].type == EV_SYN)
+	{
+		return;
+	}
+	// Emit() always leaves room for this
+	input_event &syn = _events[_event_count++];
+	memset(&syn, 0, sizeof(syn));
+	syn.type = EV_SYN;
+	syn.code = SYN_REPORT;
+}
+
+void UInputDevice::Flush()
+{
+	if (_event_count == 0 || _fd == -1)
+	{
+		_event_count = 0;
+		return;
+	}
+	Sync();
+	TRACE_SCOPE("uinput write");
+	ssize_t size = sizeof(input_event) * _event_count;
+	if (write(_fd, _events, size) != size)
+	{
+		printf("Could not write uinput events\n");
+	}
+	_event_count = 0;
+}
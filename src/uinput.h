@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <linux/input.h>
+
+// only defined by kernel headers since 5.0
+#ifndef REL_WHEEL_HI_RES
+#define REL_WHEEL_HI_RES 0x0b
+#endif
+
+const int UINPUT_MAX_EVENTS = 64;
+
+// virtual input device created through /dev/uinput
+// events are queued with Emit() and sent to the kernel in a single write by Flush()
+class UInputDevice
+{
+  public:
+	UInputDevice();
+	~UInputDevice();
+	UInputDevice(const UInputDevice &) = delete;
+	UInputDevice &operator=(const UInputDevice &) = delete;
+
+	// mouse with a high resolution scroll wheel, which X turns into smooth XI2 scroll events
+	bool CreateScrollWheel();
+	// tablet-like pointer with three buttons, covering the whole root window
+	bool CreateAbsolutePointer(int width, int height);
+	bool IsOpen();
+
+	void Emit(uint16_t type, uint16_t code, int32_t value);
+	void Sync();
+	void Flush();
+
+  private:
+	bool Create(const char *name);
+
+	int _fd;
+	input_event _events[UINPUT_MAX_EVENTS];
+	int _event_count;
+};
@@ -20,6 +20,11 @@ struct Ray
 	Panel *hit_panel;
 };
 
+struct CursorPos
+{
+	int x, y;
+};
+
 struct Color
 {
 	float r;
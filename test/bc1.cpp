@@ -0,0 +1,167 @@
+// tests of src/bc1.cpp, run by make bc1test
+#include "../src/bc1.h"
+#include "test.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// a BC1 block back to BGRX, both the 4 and the 3 color mode
+static void DecodeBlock(const uint8_t *block, uint8_t out[64])
+{
+	uint16_t color0, color1;
+	uint32_t indices;
+	memcpy(&color0, block, 2);
+	memcpy(&color1, block + 2, 2);
+	memcpy(&indices, block + 4, 4);
+	int palette[4][3];
+	for (int e = 0; e < 2; e++)
+	{
+		uint16_t c = e ? color1 : color0;
+		int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+		palette[e][0] = b << 3 | b >> 2;
+		palette[e][1] = g << 2 | g >> 4;
+		palette[e][2] = r << 3 | r >> 2;
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		int index = (indices >> (i * 2)) & 3;
+		for (int c = 0; c < 3; c++)
+			out[i * 4 + c] = palette[index][c];
+		out[i * 4 + 3] = 0xff;
+	}
+}
+
+// largest difference of any channel between a block and how it decodes
+static int EncodeError(const uint8_t block[64])
+{
+	uint8_t encoded[BC1_BLOCK_BYTES], decoded[64];
+	EncodeBc1Row(block, 4, 4, 0, encoded);
+	DecodeBlock(encoded, decoded);
+	int error = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+			error = std::max(error, abs(block[i * 4 + c] - decoded[i * 4 + c]));
+	}
+	return error;
+}
+
+// a color that survives the trip through 565 unchanged
+static uint32_t Exact565(uint32_t random)
+{
+	int r = random >> 11 & 31, g = random >> 5 & 63, b = random & 31;
+	return 0xff000000 | (r << 3 | r >> 2) << 16 | (g << 2 | g >> 4) << 8 | (b << 3 | b >> 2);
+}
+
+static void FillBlock(uint8_t block[64], uint32_t a, uint32_t b, uint32_t pattern)
+{
+	for (int i = 0; i < 16; i++)
+	{
+		uint32_t pixel = (pattern >> i) & 1 ? a : b;
+		memcpy(block + i * 4, &pixel, 4);
+	}
+}
+
+// text is mostly blocks of two colors, which have to come out exactly as they went in
+static void TestTwoColors()
+{
+	uint8_t block[64];
+	// black on white in the shape of a glyph's stem, and every other one/two color pattern
+	FillBlock(block, 0xff000000, 0xffffffff, 0x6666);
+	CHECK(EncodeError(block) == 0, "black and white text is off by %d", EncodeError(block));
+	for (uint32_t pattern = 0; pattern < 0x10000; pattern += 0x101)
+	{
+		FillBlock(block, 0xffffffff, 0xff000000, pattern);
+		CHECK(EncodeError(block) == 0, "black and white pattern %04x is off by %d", pattern, EncodeError(block));
+	}
+	uint64_t random = 0x853c49e6748fea9b;
+	for (int round = 0; round < 10000; round++)
+	{
+		uint32_t a = Exact565(TestRandom(&random)), b = Exact565(TestRandom(&random));
+		uint32_t pattern = TestRandom(&random);
+		FillBlock(block, a, b, pattern);
+		int error = EncodeError(block);
+		CHECK(error == 0, "colors %06x and %06x in pattern %04x are off by %d", a & 0xffffff, b & 0xffffff, pattern & 0xffff, error);
+	}
+}
+
+// smooth content is approximated, a straight gradient lies on the line between the endpoints
+static void TestGradients()
+{
+	uint8_t block[64];
+	uint64_t random = 0xda3e39cb94b95bdb;
+	int worst = 0;
+	for (int round = 0; round < 10000; round++)
+	{
+		int start[3], step[3];
+		for (int c = 0; c < 3; c++)
+		{
+			step[c] = (int)(TestRandom(&random) % 17) - 8;
+			start[c] = 128 + (int)(TestRandom(&random) % 32);
+		}
+		bool vertical = round % 2;
+		for (int i = 0; i < 16; i++)
+		{
+			int position = vertical ? i / 4 : i % 4;
+			for (int c = 0; c < 3; c++)
+				block[i * 4 + c] = std::clamp(start[c] + step[c] * position, 0, 255);
+			block[i * 4 + 3] = 0xff;
+		}
+		worst = std::max(worst, EncodeError(block));
+	}
+	// a quarter of the way between palette entries plus the 565 rounding of both endpoints
+	CHECK(worst <= 8, "gradients are off by up to %d", worst);
+}
+
+// the worker threads write the same blocks as encoding row by row, edge blocks included
+static void TestEncoder()
+{
+	const int width = 37, height = 23;
+	std::vector<uint8_t> pixels(width * height * 4);
+	uint64_t random = 0x94d049bb133111eb;
+	for (auto &byte : pixels)
+		byte = TestRandom(&random);
+	int block_rows = (height + 3) / 4;
+	size_t row_bytes = (size_t)((width + 3) / 4) * BC1_BLOCK_BYTES;
+	std::vector<uint8_t> expected(Bc1Size(width, height));
+	for (int row = 0; row < block_rows; row++)
+		EncodeBc1Row(pixels.data(), width, height, row, expected.data() + row * row_bytes);
+
+	Bc1Encoder encoder;
+	encoder.Init(3, 64, 64);
+	for (int round = 0; round < 20; round++)
+	{
+		CHECK(encoder.Start(pixels.data(), width, height), "round %d did not start", round);
+		CHECK(!encoder.Start(pixels.data(), width, height), "started while busy");
+		while (!encoder.IsDone())
+		{
+		}
+		CHECK(encoder.Size() == expected.size(), "size %zu, expected %zu", encoder.Size(), expected.size());
+		CHECK(memcmp(encoder.Data(), expected.data(), expected.size()) == 0, "round %d differs from row by row encoding", round);
+		encoder.Release();
+	}
+	CHECK(!encoder.Start(pixels.data(), 64, 68), "started an image larger than it was set up for");
+	encoder.Stop();
+}
+
+int main()
+{
+	TestTwoColors();
+	TestGradients();
+	TestEncoder();
+	return TestResult("bc1");
+}
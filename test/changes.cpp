@@ -0,0 +1,276 @@
+// tests of src/changes.cpp, run by make changetest
+#include "../src/changes.h"
+#include "test.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// the SSE2 hash has to match the scalar one, or tiles hashed on different paths would never compare equal
+static void TestHashRow()
+{
+	uint64_t random = 0x2545f4914f6cdd1d;
+	const int max_width = 4 * TILE_SIZE + 3;
+	// one pixel of slack on either side, so unaligned starts are covered as well
+	std::vector<uint8_t> row((max_width + 2) * 4);
+	for (int width = 1; width <= max_width; width++)
+	{
+		for (int round = 0; round < 8; round++)
+		{
+			for (auto &byte : row)
+			{
+				byte = TestRandom(&random);
+			}
+			const uint8_t *pixels = row.data() + (round % 2) * 4 + (round % 4 >= 2);
+			uint64_t fast = HashRow(pixels, width);
+			uint64_t scalar = HashRowScalar(pixels, width);
+			CHECK(fast == scalar, "width %d round %d: %016lx != %016lx", width, round, fast, scalar);
+		}
+	}
+	// a single bit changes the hash, wherever it is
+	std::vector<uint8_t> flat(TILE_SIZE * 4, 0x80);
+	uint64_t base = HashRow(flat.data(), TILE_SIZE);
+	for (int bit = 0; bit < TILE_SIZE * 32; bit++)
+	{
+		flat[bit / 8] ^= 1 << (bit % 8);
+		CHECK(HashRow(flat.data(), TILE_SIZE) != base, "flipping bit %d kept the hash", bit);
+		flat[bit / 8] ^= 1 << (bit % 8);
+	}
+}
+
+// a line of a long document, every fifth one is blank like the gaps between paragraphs
+static uint32_t DocumentPixel(int line, int x)
+{
+	if (line % 5 == 0)
+		return 0xff202020;
+	uint64_t state = (uint64_t)(line + 1) * 0x9E3779B97F4A7C15ull + x * 0xBF58476D1CE4E5B9ull;
+	return 0xff000000 | (TestRandom(&state) & 0xffffff);
+}
+
+// what the panel does with the texture, on the CPU: the shifts go through a scratch copy like
+// Panel::ApplyShifts, then runs are uploaded from the capture
+class ModelTexture
+{
+  public:
+	ModelTexture(int width, int height) : _width(width), _height(height), _pixels(width * height), _scratch(width * height)
+	{
+	}
+
+	void ApplyShifts(const std::vector<TileShift> &shifts)
+	{
+		for (auto &shift : shifts)
+		{
+			for (int y = 0; y < shift.height; y++)
+				memcpy(&_scratch[(shift.src_y + y) * _width + shift.x], &_pixels[(shift.src_y + y) * _width + shift.x], shift.width * 4);
+			for (int y = 0; y < shift.height; y++)
+				memcpy(&_pixels[(shift.dst_y + y) * _width + shift.x], &_scratch[(shift.src_y + y) * _width + shift.x], shift.width * 4);
+			shifted_bytes += (size_t)shift.width * shift.height * 4;
+		}
+	}
+
+	void Upload(const std::vector<TileRun> &runs, const uint32_t *frame)
+	{
+		for (auto &run : runs)
+		{
+			for (int y = run.y; y < run.y + run.height; y++)
+				memcpy(&_pixels[y * _width + run.x], &frame[y * _width + run.x], run.width * 4);
+			uploaded_bytes += (size_t)run.width * run.height * 4;
+		}
+	}
+
+	// a capture the way Panel::Render and Panel::UploadPending handle it, with budget bytes per update
+	// returns the number of updates it took until nothing was pending
+	int Capture(ChangeDetector *changes, const uint32_t *frame, uint64_t now, size_t budget)
+	{
+		changes->Update((const uint8_t *)frame, now);
+		ApplyShifts(changes->Shifts());
+		Upload(changes->Runs(), frame);
+		int updates = 0;
+		while (changes->HasPending())
+		{
+			size_t left = budget;
+			changes->Schedule(&left, -1, -1, now, UINT64_MAX);
+			Upload(changes->Runs(), frame);
+			updates++;
+		}
+		return updates;
+	}
+
+	bool Matches(const uint32_t *frame)
+	{
+		return memcmp(_pixels.data(), frame, _pixels.size() * 4) == 0;
+	}
+
+	size_t uploaded_bytes = 0;
+	size_t shifted_bytes = 0;
+
+  private:
+	int _width, _height;
+	std::vector<uint32_t> _pixels;
+	std::vector<uint32_t> _scratch;
+};
+
+// columns from pane_x to pane_end show the document from line offset, the rest a static one
+static void DrawFrame(std::vector<uint32_t> *frame, int width, int height, int pane_x, int pane_end, int offset)
+{
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			bool in_pane = x >= pane_x && x < pane_end;
+			(*frame)[y * width + x] = in_pane ? DocumentPixel(y + offset, x) : DocumentPixel(y + 100000, x) ^ 0x00ffffff;
+		}
+	}
+}
+
+// scrolling has to leave the texture equal to the new capture, through the shifts and the exposed rows
+static void TestScroll()
+{
+	// neither side a multiple of TILE_SIZE, so the last row and column of tiles are partial
+	const int width = 300, height = 700;
+	struct Pane
+	{
+		int x, end;
+	};
+	// the whole width, tile aligned columns, and a pane whose edges cut through tiles
+	const Pane panes[] = {{0, width}, {TILE_SIZE, 3 * TILE_SIZE}, {40, 210}};
+	const int scrolls[] = {1, 7, 16, TILE_SIZE, 100, MAX_SCROLL, MAX_SCROLL + 1, 400};
+	std::vector<uint32_t> frame(width * height);
+	for (auto pane : panes)
+	{
+		for (int sign = -1; sign <= 1; sign += 2)
+		{
+			for (int scroll : scrolls)
+			{
+				ChangeDetector changes;
+				changes.Init(width, height, true);
+				ModelTexture texture(width, height);
+				int offset = 1000;
+				DrawFrame(&frame, width, height, pane.x, pane.end, offset);
+				texture.Capture(&changes, frame.data(), 0, SIZE_MAX);
+				CHECK(texture.Matches(frame.data()), "first capture, pane %d-%d", pane.x, pane.end);
+				// scrolling twice the same way, so the second one starts from a shifted texture
+				for (int step = 1; step <= 2; step++)
+				{
+					texture.uploaded_bytes = texture.shifted_bytes = 0;
+					offset += sign * scroll;
+					DrawFrame(&frame, width, height, pane.x, pane.end, offset);
+					texture.Capture(&changes, frame.data(), step, SIZE_MAX);
+					CHECK(texture.Matches(frame.data()), "pane %d-%d, scroll %d, step %d", pane.x, pane.end, sign * scroll, step);
+					if (pane.x == 0 && scroll <= MAX_SCROLL && scroll * 2 < height)
+					{
+						CHECK(texture.shifted_bytes > 0, "scroll %d by the whole width was not detected", sign * scroll);
+						CHECK(texture.uploaded_bytes < (size_t)width * height * 4 / 2,
+							  "scroll %d uploaded %zu bytes", sign * scroll, texture.uploaded_bytes);
+					}
+				}
+			}
+		}
+	}
+}
+
+// every tile filled with one of a few versions of its content
+static void DrawTiles(std::vector<uint32_t> *frame, int width, int height, const std::vector<int> &versions)
+{
+	int columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int tile = y / TILE_SIZE * columns + x / TILE_SIZE;
+			(*frame)[y * width + x] = DocumentPixel(y * 7 + versions[tile] * 100003 + 1, x);
+		}
+	}
+}
+
+static bool RunsStartAt(const std::vector<TileRun> &runs, int x, int y)
+{
+	return !runs.empty() && runs[0].x == x && runs[0].y == y;
+}
+
+// uploads under a budget have to end up with every tile, in the order of deadline and focus
+static void TestSchedule()
+{
+	const int width = 5 * TILE_SIZE - 10, height = 4 * TILE_SIZE + 20;
+	const int columns = 5, rows = 5;
+	const size_t tile_bytes = TILE_SIZE * TILE_SIZE * 4;
+	const uint64_t ms = 1000000;
+	const uint64_t deadline = 100 * ms;
+	std::vector<uint32_t> frame(width * height);
+	std::vector<int> versions(columns * rows, 0);
+
+	// a budget of one tile per update drains a full change one tile at a time, partial tiles may share one
+	ChangeDetector changes;
+	changes.Init(width, height, false);
+	ModelTexture texture(width, height);
+	DrawTiles(&frame, width, height, versions);
+	int updates = texture.Capture(&changes, frame.data(), 0, tile_bytes);
+	int least = (width * height * 4 + tile_bytes - 1) / tile_bytes;
+	CHECK(updates >= least && updates <= columns * rows, "drained %d tiles in %d updates", columns * rows, updates);
+	CHECK(texture.Matches(frame.data()), "texture differs after draining with a small budget");
+	CHECK(!changes.HasPending(), "tiles still pending");
+
+	// nearest to the focus first
+	for (auto &version : versions)
+		version++;
+	DrawTiles(&frame, width, height, versions);
+	changes.Update((const uint8_t *)frame.data(), 1 * ms);
+	size_t budget = tile_bytes;
+	changes.Schedule(&budget, 3 * TILE_SIZE + 5, 2 * TILE_SIZE + 5, 2 * ms, deadline);
+	CHECK(RunsStartAt(changes.Runs(), 3 * TILE_SIZE, 2 * TILE_SIZE), "the focused tile was not uploaded first");
+	texture.Upload(changes.Runs(), frame.data());
+	budget = tile_bytes;
+	changes.Schedule(&budget, 0, 0, 2 * ms, deadline);
+	CHECK(RunsStartAt(changes.Runs(), 0, 0), "the tile at the new focus was not uploaded next");
+	texture.Upload(changes.Runs(), frame.data());
+
+	// a new capture while the last one is still draining: tiles it changes again, tiles it changes back
+	// and tiles it leaves alone all have to end up like it, and the old pending ones keep their age
+	versions[0] = 0;       // uploaded already, now back to the first version
+	versions[1] += 1;      // still pending, changed again
+	versions[2 * columns + 3] = 0; // uploaded, changed back
+	versions[columns * rows - 1] += 5;
+	DrawTiles(&frame, width, height, versions);
+	changes.Update((const uint8_t *)frame.data(), 150 * ms);
+	// everything from the capture at 1 ms is overdue now, the tiles changed at 150 ms are not
+	budget = tile_bytes;
+	changes.Schedule(&budget, 0, 0, 160 * ms, deadline);
+	int overdue_picked = (int)changes.Runs().size();
+	bool picked_fresh = false, picked_changed_again = false;
+	for (auto &run : changes.Runs())
+	{
+		// run.x == 0 && run.y == 0 is tile 0, which is only pending since 150 ms
+		picked_fresh |= run.x == 0 && run.y == 0;
+		picked_fresh |= run.x == 3 * TILE_SIZE && run.y == 2 * TILE_SIZE;
+		picked_changed_again |= run.y == 0 && run.x <= TILE_SIZE && run.x + run.width > TILE_SIZE;
+	}
+	CHECK(overdue_picked > 0 && !picked_fresh, "overdue tiles did not go first, or ignored the budget");
+	CHECK(picked_changed_again, "a tile changed again while pending lost its age");
+	texture.Upload(changes.Runs(), frame.data());
+	int drain = 0;
+	while (changes.HasPending() && drain < columns * rows)
+	{
+		budget = tile_bytes;
+		changes.Schedule(&budget, -1, -1, 160 * ms, deadline);
+		texture.Upload(changes.Runs(), frame.data());
+		drain++;
+	}
+	CHECK(!changes.HasPending(), "tiles still pending after %d updates", drain);
+	CHECK(texture.Matches(frame.data()), "texture differs from the capture that arrived while draining");
+
+	// MarkUploaded after a whole upload leaves nothing pending
+	for (auto &version : versions)
+		version++;
+	DrawTiles(&frame, width, height, versions);
+	changes.Update((const uint8_t *)frame.data(), 200 * ms);
+	CHECK(changes.HasPending(), "a changed capture left nothing pending");
+	changes.MarkUploaded();
+	CHECK(!changes.HasPending(), "MarkUploaded left tiles pending");
+}
+
+int main()
+{
+	TestHashRow();
+	TestScroll();
+	TestSchedule();
+	return TestResult("changes");
+}
@@ -0,0 +1,141 @@
+// tests of src/pixelformat.cpp, run by make pixeltest
+#include "../src/pixelformat.h"
+#include "test.h"
+#include <cstring>
+#include <vector>
+
+const int CHUNK = 1 << 20;   // pixels converted at once in the sweeps
+const int MAX_WIDTH = 67;    // narrow images cover every tail length of the SIMD loops
+const int ROWS = 5;
+const uint8_t GUARD_BYTE = 0xa5;
+
+// written per channel rather than with the masks the kernels use, so it doesn't share their mistakes
+static uint32_t Expected565(uint16_t v)
+{
+	uint32_t r = v >> 11, g = (v >> 5) & 0x3f, b = v & 0x1f;
+	r = (r << 3) | (r >> 2);
+	g = (g << 2) | (g >> 4);
+	b = (b << 3) | (b >> 2);
+	return 0xff000000 | r << 16 | g << 8 | b;
+}
+
+static uint32_t Expected2101010(uint32_t v)
+{
+	uint32_t r = (v >> 20) & 0x3ff, g = (v >> 10) & 0x3ff, b = v & 0x3ff;
+	return 0xff000000 | (r >> 2) << 16 | (g >> 2) << 8 | (b >> 2);
+}
+
+static uint32_t ExpectedPixel(PixelFormat format, const uint8_t *src)
+{
+	if (format == PixelFormat::R5G6B5)
+	{
+		uint16_t v;
+		memcpy(&v, src, 2);
+		return Expected565(v);
+	}
+	uint32_t v;
+	memcpy(&v, src, 4);
+	return Expected2101010(v);
+}
+
+// converts src with every kernel and compares with expected, including the guard bytes past the end
+static void CheckKernels(PixelFormat format, const uint8_t *src, size_t src_stride, int width, int height,
+						 const std::vector<uint8_t> &expected)
+{
+	static std::vector<uint8_t> actual;
+	for (int kernel = 0; kernel < PixelKernelCount(); kernel++)
+	{
+		actual.assign(expected.size(), GUARD_BYTE);
+		ConvertToBgrxWith(kernel, format, src, src_stride, actual.data(), width, height);
+		if (actual == expected)
+			continue;
+		size_t i = 0;
+		while (actual[i] == expected[i])
+			i++;
+		CHECK(actual[i] == expected[i], "%s %s, byte %zu of a %dx%d image is %02x", PixelKernelName(kernel),
+			  PixelFormatName(format), i, width, height, actual[i]);
+	}
+}
+
+static void TestEveryPixel()
+{
+	std::vector<uint8_t> src(CHUNK * 4);
+	std::vector<uint8_t> expected;
+
+	// every 16 bit pixel
+	expected.assign(65536 * 4 + 64, GUARD_BYTE);
+	for (uint32_t v = 0; v < 65536; v++)
+	{
+		memcpy(&src[v * 2], &v, 2);
+		uint32_t out = Expected565(v);
+		memcpy(&expected[v * 4], &out, 4);
+	}
+	CheckKernels(PixelFormat::R5G6B5, src.data(), 65536 * 2, 65536, 1, expected);
+
+	// every 32 bit pixel, including the unused top bits
+	expected.assign(CHUNK * 4 + 64, GUARD_BYTE);
+	for (uint64_t first = 0; first < (1ull << 32); first += CHUNK)
+	{
+		for (uint32_t i = 0; i < CHUNK; i++)
+		{
+			uint32_t v = first + i;
+			memcpy(&src[i * 4], &v, 4);
+			uint32_t out = Expected2101010(v);
+			memcpy(&expected[i * 4], &out, 4);
+		}
+		CheckKernels(PixelFormat::X2R10G10B10, src.data(), CHUNK * 4, CHUNK, 1, expected);
+	}
+}
+
+// narrow images with padded rows, as ZPixmaps come with
+static void TestWidths()
+{
+	uint64_t random = 0x9e3779b97f4a7c15;
+	std::vector<uint8_t> src((ZPixmapStride(PixelFormat::X2R10G10B10, MAX_WIDTH, 32) + 12) * ROWS);
+	for (auto &byte : src)
+		byte = TestRandom(&random);
+	std::vector<uint8_t> expected;
+	for (int width = 1; width <= MAX_WIDTH; width++)
+	{
+		for (auto format : {PixelFormat::R5G6B5, PixelFormat::X2R10G10B10})
+		{
+			size_t stride = ZPixmapStride(format, width, 32) + 12;
+			expected.assign((size_t)width * ROWS * 4 + 64, GUARD_BYTE);
+			for (int y = 0; y < ROWS; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					uint32_t out = ExpectedPixel(format, &src[y * stride + x * BitsPerPixel(format) / 8]);
+					memcpy(&expected[(y * width + x) * 4], &out, 4);
+				}
+			}
+			CheckKernels(format, src.data(), stride, width, ROWS, expected);
+		}
+	}
+}
+
+static void TestFindPixelFormat()
+{
+	CHECK(FindPixelFormat(32, true, 0xff0000, 0xff00, 0xff) == PixelFormat::BGRX, "depth 24");
+	CHECK(FindPixelFormat(32, true, 0x3ff00000, 0xffc00, 0x3ff) == PixelFormat::X2R10G10B10, "depth 30");
+	CHECK(FindPixelFormat(16, true, 0xf800, 0x7e0, 0x1f) == PixelFormat::R5G6B5, "depth 16");
+	CHECK(FindPixelFormat(24, true, 0xff0000, 0xff00, 0xff) == PixelFormat::Unsupported, "packed 24 bit");
+	for (int bits : {16, 32})
+	{
+		CHECK(FindPixelFormat(bits, false, 0xff0000, 0xff00, 0xff) == PixelFormat::Unsupported, "MSB first");
+		CHECK(FindPixelFormat(bits, false, 0x3ff00000, 0xffc00, 0x3ff) == PixelFormat::Unsupported, "MSB first");
+		CHECK(FindPixelFormat(bits, false, 0xf800, 0x7e0, 0x1f) == PixelFormat::Unsupported, "MSB first");
+	}
+}
+
+int main()
+{
+	printf("kernels:");
+	for (int kernel = 0; kernel < PixelKernelCount(); kernel++)
+		printf(" %s", PixelKernelName(kernel));
+	printf("\n");
+	TestFindPixelFormat();
+	TestWidths();
+	TestEveryPixel();
+	return TestResult("pixelformat");
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+
+// minimal checks for the tests in this directory, every failure is printed and counted, main returns
+// TestResult() so make fails when any check did
+inline int test_failures = 0;
+
+#define CHECK(condition, ...)                                  \
+	do                                                         \
+	{                                                          \
+		if (!(condition))                                      \
+		{                                                      \
+			printf("%s:%d: %s failed: ", __FILE__, __LINE__, #condition); \
+			printf(__VA_ARGS__);                               \
+			printf("\n");                                      \
+			test_failures++;                                   \
+		}                                                      \
+	} while (0)
+
+// xorshift, the same sequence on every run
+inline uint32_t TestRandom(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return (uint32_t)(*state >> 32);
+}
+
+inline int TestResult(const char *name)
+{
+	if (test_failures)
+	{
+		printf("%s: %d checks failed\n", name, test_failures);
+		return 1;
+	}
+	printf("%s: passed\n", name);
+	return 0;
+}